@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+# Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License. You may obtain
+# a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations
+# under the License.
+
+"""Decode esp_eb_trace_dump output into a timeline.
+
+Usage: eb_trace.py [serial_log]
+
+Reads the log from the file or standard input. Lines not belonging
+to the dump are ignored so the whole serial console log can be used.
+"""
+
+import sys
+
+PHASES = ("triggered", "dispatched", "throttled", "dropped")
+SUB_NONE = 0x3FFF
+
+
+def parse(lines):
+    """Return (recorded count, event names, entries) of the last dump."""
+    names, entries, total = {}, [], 0
+
+    for line in lines:
+        parts = line.split()
+        if not parts:
+            continue
+
+        if parts[0] == "EBT" and len(parts) == 3:
+            names, entries, total = {}, [], int(parts[1])
+        elif parts[0] == "EBN" and len(parts) >= 3:
+            names[int(parts[1])] = " ".join(parts[2:])
+        elif parts[0] == "EBE":
+            for rec in parts[1:]:
+                entries.append((int(rec[0:8], 16), int(rec[8:12], 16), int(rec[12:16], 16)))
+
+    return total, names, entries
+
+
+def timeline(total, names, entries, out):
+    if not entries:
+        out.write("no trace entries\n")
+        return
+
+    if total > len(entries):
+        out.write("%d oldest entries were overwritten\n" % (total - len(entries)))
+
+    start = entries[0][0]
+    triggered = {}
+
+    for ts, eid, info in entries:
+        # Microsecond timer wraps every ~71 minutes.
+        rel = (ts - start) & 0xFFFFFFFF
+        phase = PHASES[info >> 14]
+        sub = info & SUB_NONE
+        name = names.get(eid, "#%d" % eid)
+
+        line = "%12.3f ms  %-10s  %-32s" % (rel / 1000.0, phase, name)
+        if sub != SUB_NONE:
+            line += "  sub %-4d" % sub
+        if phase == "triggered":
+            triggered[eid] = ts
+        elif phase == "dispatched" and eid in triggered:
+            line += "  +%d us" % ((ts - triggered[eid]) & 0xFFFFFFFF)
+
+        out.write(line.rstrip() + "\n")
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    with src:
+        timeline(*parse(src), out=sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
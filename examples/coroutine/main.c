@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <user_interface.h>
+#include <osapi.h>
+#include "esp_sdo.h"
+#include "esp_co.h"
+
+// The event triggered by the coroutine for itself.
+#define MY_EVENT "myEvent"
+
+
+typedef struct {
+  uint8_t val1;
+  int8_t val2;
+  uint32_t delay;
+  esp_eb_id event;
+} my_data;
+
+static my_data data;
+static esp_co co;
+static esp_tim_timer event_timer;
+
+
+// Triggers the event the coroutine waits for.
+static void ICACHE_FLASH_ATTR
+event_timer_cb(void *arg)
+{
+  esp_eb_trigger_id(data.event, "hello");
+}
+
+// The same sequence as the timer example without callback rearming.
+esp_co_state ICACHE_FLASH_ATTR
+my_co(esp_co *co)
+{
+  my_data *data = co->payload;
+
+  ESP_CO_BEGIN(co);
+
+  for (data->delay = ESP_TIM_DELAY_DEF; data->val1 <= 8; data->delay *= 2) {
+    ESP_CO_SLEEP_MS(co, data->delay);
+    os_printf("Coroutine val1: %d, val2: %d\n", data->val1, data->val2);
+    data->val1++;
+    data->val2--;
+  }
+
+  // Triggers without subscribers are dropped. Fire the event from
+  // a timer, the coroutine subscribes before the timer expires.
+  esp_tim_arm(&event_timer);
+  ESP_CO_WAIT_EVENT(co, data->event);
+  os_printf("Event %s with %s\n", MY_EVENT, (char *) co->event_arg);
+
+  os_printf("END\n");
+  ESP_CO_END(co);
+}
+
+void ICACHE_FLASH_ATTR
+sys_init_done(void)
+{
+  data.event = esp_eb_register(MY_EVENT);
+  esp_tim_init(&event_timer, event_timer_cb, NULL, 500);
+
+  esp_co_init(&co, my_co, &data);
+  esp_co_start(&co);
+}
+
+void ICACHE_FLASH_ATTR
+user_init()
+{
+  // No need for wifi for this example.
+  wifi_station_disconnect();
+  wifi_set_opmode_current(NULL_MODE);
+
+  stdout_init(BIT_RATE_74880);
+  system_init_done_cb(sys_init_done);
+}
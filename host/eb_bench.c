@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Event bus throughput and latency benchmark.
+//
+// Usage: eb_bench [-e events] [-s subscribers] [-n triggers] [-m timer|queue|sync|batch]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "esp_host.h"
+#include "esp_eb.h"
+
+// The maximum number of subscribers per event.
+#define BENCH_MAX_SUBS 16
+
+// The number of triggers in flight before running dispatcher.
+#define BENCH_BURST 32
+
+// The maximum number of latency samples.
+#define BENCH_MAX_SAMPLES 1000000
+
+static uint32_t *trigger_us; // Trigger time by sequence number.
+static uint32_t *samples;    // Dispatch latencies.
+static uint32_t samples_cnt;
+static uint32_t calls;
+
+static void
+bench_cb(const char *event, void *arg)
+{
+  uint32_t seq = (uint32_t) (size_t) arg;
+
+  calls++;
+  if (samples_cnt < BENCH_MAX_SAMPLES) {
+    samples[samples_cnt++] = system_get_time() - trigger_us[seq];
+  }
+}
+
+// Attach refuses the same callback twice so every subscriber gets its own.
+#define BENCH_CB(n) static void bench_cb##n(const char *e, void *a) { bench_cb(e, a); }
+BENCH_CB(0) BENCH_CB(1) BENCH_CB(2) BENCH_CB(3) BENCH_CB(4) BENCH_CB(5) BENCH_CB(6) BENCH_CB(7)
+BENCH_CB(8) BENCH_CB(9) BENCH_CB(10) BENCH_CB(11) BENCH_CB(12) BENCH_CB(13) BENCH_CB(14) BENCH_CB(15)
+
+static esp_eb_cb *callbacks[BENCH_MAX_SUBS] = {
+  bench_cb0, bench_cb1, bench_cb2, bench_cb3, bench_cb4, bench_cb5, bench_cb6, bench_cb7,
+  bench_cb8, bench_cb9, bench_cb10, bench_cb11, bench_cb12, bench_cb13, bench_cb14, bench_cb15,
+};
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+static double
+cpu_s(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-e events] [-s subscribers] [-n triggers] [-m timer|queue|sync|batch]\n", name);
+  exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt;
+  uint32_t events = 8, subs = 4, triggers = 100000, seq, idx;
+  const char *mode = "timer";
+  esp_eb_id *ids;
+  esp_eb_trigger_req reqs[BENCH_BURST];
+  esp_host_mem_info before, after;
+  char name[16];
+  double start, elapsed;
+
+  while ((opt = getopt(argc, argv, "e:s:n:m:")) != -1) {
+    switch (opt) {
+      case 'e': events = (uint32_t) atoi(optarg); break;
+      case 's': subs = (uint32_t) atoi(optarg); break;
+      case 'n': triggers = (uint32_t) atoi(optarg); break;
+      case 'm': mode = optarg; break;
+      default: usage(argv[0]);
+    }
+  }
+
+  if (events == 0 || events > ESP_EB_MAX_EVENTS) usage(argv[0]);
+  if (subs == 0 || subs > BENCH_MAX_SUBS || triggers == 0) usage(argv[0]);
+
+  esp_host_quiet(true);
+  ids = calloc(events, sizeof(esp_eb_id));
+  trigger_us = calloc(triggers, sizeof(uint32_t));
+  samples = calloc(BENCH_MAX_SAMPLES, sizeof(uint32_t));
+
+  for (idx = 0; idx < events; idx++) {
+    snprintf(name, sizeof(name), "bench%u", idx);
+    ids[idx] = esp_eb_register(name);
+    for (seq = 0; seq < subs; seq++) esp_eb_attach_id(ids[idx], callbacks[seq]);
+  }
+
+  if (strcmp(mode, "queue") == 0) {
+    esp_eb_queue_init(USER_TASK_PRIO_1);
+  } else if (strcmp(mode, "timer") != 0 && strcmp(mode, "batch") != 0 && strcmp(mode, "sync") != 0) {
+    usage(argv[0]);
+  }
+
+  esp_host_mem(&before);
+  esp_host_mem_reset_peak();
+  start = cpu_s();
+
+  for (seq = 0; seq < triggers; seq++) {
+    trigger_us[seq] = system_get_time();
+
+    if (strcmp(mode, "sync") == 0) {
+      esp_eb_trigger_sync_id(ids[seq % events], (void *) (size_t) seq);
+    } else if (strcmp(mode, "batch") == 0) {
+      reqs[seq % BENCH_BURST].id = ids[seq % events];
+      reqs[seq % BENCH_BURST].arg = (void *) (size_t) seq;
+      if (seq % BENCH_BURST == BENCH_BURST - 1 || seq == triggers - 1) {
+        esp_eb_trigger_batch(reqs, seq % BENCH_BURST + 1);
+      }
+    } else {
+      esp_eb_trigger_id(ids[seq % events], (void *) (size_t) seq);
+    }
+
+    if (seq % BENCH_BURST == BENCH_BURST - 1) while (esp_host_step());
+  }
+  while (esp_host_step());
+
+  elapsed = cpu_s() - start;
+  esp_host_mem(&after);
+
+  qsort(samples, samples_cnt, sizeof(uint32_t), cmp_u32);
+  printf("mode %s, events %u, subscribers %u, triggers %u, callbacks %u\n", mode, events, subs, triggers, calls);
+  printf("triggers/sec     %.0f\n", triggers / elapsed);
+  printf("callbacks/sec    %.0f\n", calls / elapsed);
+  printf("mallocs/trigger  %.2f\n", (double) (after.mallocs - before.mallocs) / triggers);
+  printf("peak heap        %zu bytes (%zu before)\n", after.peak, before.used);
+  if (samples_cnt > 0) {
+    printf("latency p50      %u us\n", samples[samples_cnt / 2]);
+    printf("latency p99      %u us\n", samples[samples_cnt * 99 / 100]);
+  }
+
+  free(ids);
+  free(trigger_us);
+  free(samples);
+
+  return calls == triggers * subs ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Randomized event bus stress test.
+//
+// Usage: eb_stress [-s seed] [-n operations]
+//
+// Randomly attaches, detaches, triggers and cancels events (also from
+// callbacks) to catch use after free and leaks. Build with sanitizers
+// (the default) to get reports pointing to the offending code.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "esp_host.h"
+#include "esp_eb.h"
+
+#define STRESS_EVENTS 6
+#define STRESS_CBS 8
+#define STRESS_MAGIC 0x5EB5EB5Eu
+
+// Payload passed by pointer or copied.
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint8_t pad[24];
+} stress_payload;
+
+static const char *names[STRESS_EVENTS] = {"st0", "st1", "st2", "sx3", "sx4", "isr"};
+static const char *patterns[] = {"st*", "s*", "sx*"};
+static esp_eb_id ids[STRESS_EVENTS];
+static stress_payload static_payload = {.magic = STRESS_MAGIC};
+static uint32_t calls;
+static uint8_t depth;
+
+static uint32_t
+rnd(uint32_t max)
+{
+  return (uint32_t) rand() % max;
+}
+
+static void random_op(bool from_cb);
+
+static void
+stress_cb(const char *event, void *arg)
+{
+  stress_payload *payload = arg;
+
+  calls++;
+  // Interrupt triggers pass value not pointer.
+  if (strcmp(event, "isr") != 0 && payload != NULL && payload->magic != STRESS_MAGIC) {
+    fprintf(stderr, "corrupted payload for %s\n", event);
+    abort();
+  }
+
+  if (depth < 3 && rnd(4) == 0) {
+    depth++;
+    random_op(true);
+    depth--;
+  }
+}
+
+#define STRESS_CB(n) static void stress_cb##n(const char *e, void *a) { stress_cb(e, a); }
+STRESS_CB(0) STRESS_CB(1) STRESS_CB(2) STRESS_CB(3) STRESS_CB(4) STRESS_CB(5) STRESS_CB(6) STRESS_CB(7)
+
+static esp_eb_cb *callbacks[STRESS_CBS] = {
+  stress_cb0, stress_cb1, stress_cb2, stress_cb3, stress_cb4, stress_cb5, stress_cb6, stress_cb7,
+};
+
+static void
+attach_random(void)
+{
+  esp_eb_cb *cb = callbacks[rnd(STRESS_CBS)];
+  const char *event = rnd(5) == 0 ? patterns[rnd(3)] : names[rnd(STRESS_EVENTS)];
+
+  switch (rnd(4)) {
+    case 0: esp_eb_attach(event, cb); break;
+    case 1: esp_eb_attach_throttled(event, cb, rnd(20000)); break;
+    case 2: esp_eb_attach_coalesced(event, cb, 1 + rnd(30)); break;
+    default: esp_eb_attach_debounced(event, cb, 1 + rnd(30)); break;
+  }
+}
+
+static void
+trigger_random(bool from_cb)
+{
+  stress_payload stack_payload = {.magic = STRESS_MAGIC, .seq = calls};
+  esp_eb_trigger_req reqs[3];
+  uint8_t idx;
+  esp_eb_id id = ids[rnd(STRESS_EVENTS - 1)];
+
+  switch (rnd(from_cb ? 7 : 8)) {
+    case 0: esp_eb_trigger_id(id, &static_payload); break;
+    case 1: esp_eb_trigger_delayed_id(id, rnd(100), &static_payload); break;
+    case 2: esp_eb_trigger_copy_id(id, &stack_payload, sizeof(stack_payload)); break;
+    case 3: esp_eb_trigger_delayed_copy_id(id, rnd(100), &stack_payload, sizeof(stack_payload)); break;
+    case 4: esp_eb_trigger_asap_id(id, &static_payload); break;
+    case 5:
+      for (idx = 0; idx < 3; idx++) {
+        reqs[idx].id = ids[rnd(STRESS_EVENTS - 1)];
+        reqs[idx].arg = &static_payload;
+      }
+      esp_eb_trigger_batch(reqs, 3);
+      break;
+    case 6: esp_eb_trigger_sync_id(id, &static_payload); break;
+    default: esp_eb_trigger_from_isr(ids[STRESS_EVENTS - 1], rnd(1000)); break;
+  }
+}
+
+static void
+random_op(bool from_cb)
+{
+  uint32_t op = rnd(100);
+
+  if (op < 25) {
+    attach_random();
+  } else if (op < 40) {
+    esp_eb_detach(rnd(5) == 0 ? patterns[rnd(3)] : names[rnd(STRESS_EVENTS)], callbacks[rnd(STRESS_CBS)]);
+  } else if (op < 43) {
+    esp_eb_remove_cb(callbacks[rnd(STRESS_CBS)]);
+  } else if (op < 46) {
+    esp_eb_cancel_delayed_id(ids[rnd(STRESS_EVENTS)]);
+  } else if (op < 90) {
+    trigger_random(from_cb);
+  } else if (!from_cb) {
+    esp_host_run(rnd(50000));
+  }
+}
+
+/**
+ * Detach everything and run until idle.
+ */
+static void
+cleanup(void)
+{
+  uint8_t idx;
+
+  for (idx = 0; idx < STRESS_CBS; idx++) esp_eb_remove_cb(callbacks[idx]);
+  while (esp_host_step());
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-s seed] [-n operations]\n", name);
+  exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt;
+  unsigned seed = 1;
+  uint32_t ops = 200000, op;
+  uint8_t idx, cb;
+  esp_host_mem_info mem;
+  esp_eb_pool_info pool;
+  size_t baseline;
+
+  while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+    switch (opt) {
+      case 's': seed = (unsigned) strtoul(optarg, NULL, 10); break;
+      case 'n': ops = (uint32_t) strtoul(optarg, NULL, 10); break;
+      default: usage(argv[0]);
+    }
+  }
+
+  srand(seed);
+  esp_host_quiet(true);
+
+  // Register events and grow internal tables to their maximum size.
+  for (idx = 0; idx < STRESS_EVENTS; idx++) {
+    ids[idx] = esp_eb_register(names[idx]);
+    for (cb = 0; cb < STRESS_CBS; cb++) esp_eb_attach_id(ids[idx], callbacks[cb]);
+  }
+  for (idx = 0; idx < 3; idx++) {
+    for (cb = 0; cb < STRESS_CBS; cb++) esp_eb_attach(patterns[idx], callbacks[cb]);
+  }
+  cleanup();
+  esp_host_mem(&mem);
+  baseline = mem.used;
+
+  // Interrupt triggers work in timer mode too.
+  esp_eb_isr_init(USER_TASK_PRIO_1);
+  for (op = 0; op < ops; op++) {
+    // Switch to queued mode half way through.
+    if (op == ops / 2) esp_eb_queue_init(USER_TASK_PRIO_1);
+    random_op(false);
+  }
+
+  cleanup();
+  esp_host_mem(&mem);
+
+  printf("seed %u, operations %u, callbacks %u, peak heap %zu\n", seed, ops, calls, mem.peak);
+
+  if (mem.used != baseline) {
+    fprintf(stderr, "leaked %zd bytes\n", (ssize_t) (mem.used - baseline));
+    return 1;
+  }
+  if (esp_host_timers_armed() != 0) {
+    fprintf(stderr, "%u timers still armed\n", esp_host_timers_armed());
+    return 1;
+  }
+  for (idx = 0; idx < ESP_EB_POOL_CNT; idx++) {
+    esp_eb_pool_usage((esp_eb_pool) idx, &pool);
+    if (pool.used != 0) {
+      fprintf(stderr, "pool %u has %u records in use\n", idx, pool.used);
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Host implementation of the SDK functions used by the libraries.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mem.h>
+#include <osapi.h>
+#include <user_interface.h>
+#include "esp_host.h"
+
+// Allocation header keeping the block size.
+typedef union {
+  size_t size;
+  long double align;
+} host_block;
+
+// SDK task.
+typedef struct {
+  os_task_t task;     // Task function.
+  os_event_t *queue;  // Message queue.
+  uint8_t size;       // Message queue capacity.
+  uint8_t head;       // The oldest message.
+  uint8_t len;        // The number of messages.
+} host_task;
+
+static bool quiet;
+static esp_host_mem_info mem;
+static host_task tasks[USER_TASK_PRIO_MAX];
+static os_timer_t *timers;
+static bool clock_virtual;
+static uint64_t clock_base_us;
+static uint64_t clock_skip_us;
+static char *log_buf;
+static size_t log_len;
+static size_t log_cap;
+static wifi_event_handler_cb_t wifi_cb;
+
+static uint64_t
+real_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+uint64_t
+esp_host_now_us(void)
+{
+  if (clock_virtual) return clock_skip_us;
+  if (clock_base_us == 0) clock_base_us = real_us();
+
+  return real_us() - clock_base_us + clock_skip_us;
+}
+
+void
+esp_host_clock_virtual(bool on)
+{
+  uint64_t now = esp_host_now_us();
+
+  clock_virtual = on;
+  clock_base_us = real_us();
+  clock_skip_us = now;
+}
+
+/**
+ * Move the clock forward.
+ *
+ * @param us The number of microseconds.
+ */
+static void
+clock_skip(uint64_t us)
+{
+  clock_skip_us += us;
+}
+
+uint32
+system_get_time(void)
+{
+  return (uint32) esp_host_now_us();
+}
+
+void
+esp_host_quiet(bool on)
+{
+  quiet = on;
+}
+
+int
+os_printf(const char *format, ...)
+{
+  int ret;
+  va_list args;
+
+  if (quiet) return 0;
+
+  va_start(args, format);
+  ret = vprintf(format, args);
+  va_end(args);
+
+  return ret;
+}
+
+void
+os_delay_us(uint16_t us)
+{
+  uint64_t end;
+
+  if (clock_virtual) {
+    clock_skip(us);
+    return;
+  }
+
+  end = esp_host_now_us() + us;
+  while (esp_host_now_us() < end);
+}
+
+void
+esp_host_log(const char *format, ...)
+{
+  int len;
+  va_list args;
+
+  for (;;) {
+    va_start(args, format);
+    len = vsnprintf(log_buf + log_len, log_cap - log_len, format, args);
+    va_end(args);
+
+    if (len < 0) return;
+    if (log_len + (size_t) len + 1 < log_cap) break;
+
+    // Grow and format again, not counted as SDK heap usage.
+    log_cap = (log_cap + (size_t) len + 1) * 2;
+    log_buf = realloc(log_buf, log_cap);
+    if (log_buf == NULL) abort();
+    log_buf[log_len] = '\0';
+  }
+
+  log_len += (size_t) len;
+}
+
+const char *
+esp_host_log_get(void)
+{
+  return log_buf != NULL ? log_buf : "";
+}
+
+void
+esp_host_log_clear(void)
+{
+  log_len = 0;
+  if (log_buf != NULL) log_buf[0] = '\0';
+}
+
+void *
+os_malloc(size_t size)
+{
+  host_block *block = malloc(sizeof(host_block) + size);
+  if (block == NULL) return NULL;
+
+  block->size = size;
+  mem.mallocs++;
+  mem.used += size;
+  if (mem.used > mem.peak) mem.peak = mem.used;
+
+  return block + 1;
+}
+
+void *
+os_zalloc(size_t size)
+{
+  void *ptr = os_malloc(size);
+  if (ptr != NULL) memset(ptr, 0, size);
+
+  return ptr;
+}
+
+void
+os_free(void *ptr)
+{
+  host_block *block;
+
+  if (ptr == NULL) return;
+
+  block = (host_block *) ptr - 1;
+  mem.frees++;
+  mem.used -= block->size;
+  free(block);
+}
+
+void *
+os_realloc(void *ptr, size_t size)
+{
+  void *new;
+  size_t old;
+
+  if (ptr == NULL) return os_malloc(size);
+
+  old = ((host_block *) ptr - 1)->size;
+  new = os_malloc(size);
+  if (new == NULL) return NULL;
+
+  memcpy(new, ptr, old < size ? old : size);
+  os_free(ptr);
+
+  return new;
+}
+
+uint32
+system_get_free_heap_size(void)
+{
+  return (uint32) (80 * 1024 - mem.used);
+}
+
+void
+esp_host_mem(esp_host_mem_info *info)
+{
+  *info = mem;
+}
+
+void
+esp_host_mem_reset_peak(void)
+{
+  mem.peak = mem.used;
+}
+
+/**
+ * Remove timer from the armed timers list.
+ *
+ * @param ptimer The timer.
+ */
+static void
+timer_unlink(os_timer_t *ptimer)
+{
+  os_timer_t **link;
+
+  for (link = &timers; *link != NULL; link = &(*link)->timer_next) {
+    if (*link != ptimer) continue;
+    *link = ptimer->timer_next;
+    break;
+  }
+  ptimer->timer_next = NULL;
+}
+
+/**
+ * Add timer to the armed timers list ordered by expiry.
+ *
+ * Timers with the same expiry fire in order of arming.
+ *
+ * @param ptimer The timer.
+ */
+static void
+timer_link(os_timer_t *ptimer)
+{
+  os_timer_t **link = &timers;
+
+  while (*link != NULL && (int32_t) ((*link)->timer_expire - ptimer->timer_expire) <= 0) {
+    link = &(*link)->timer_next;
+  }
+
+  ptimer->timer_next = *link;
+  *link = ptimer;
+}
+
+void
+os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg)
+{
+  ptimer->timer_func = pfunction;
+  ptimer->timer_arg = parg;
+}
+
+void
+os_timer_arm_us(os_timer_t *ptimer, uint32_t us, bool repeat_flag)
+{
+  // The SDK requires disarm before arm, we are forgiving.
+  timer_unlink(ptimer);
+  ptimer->timer_expire = system_get_time() + us;
+  ptimer->timer_period = repeat_flag ? us : 0;
+  timer_link(ptimer);
+}
+
+void
+os_timer_arm(os_timer_t *ptimer, uint32_t ms, bool repeat_flag)
+{
+  os_timer_arm_us(ptimer, ms * 1000, repeat_flag);
+}
+
+void
+os_timer_disarm(os_timer_t *ptimer)
+{
+  timer_unlink(ptimer);
+}
+
+uint16_t
+esp_host_timers_armed(void)
+{
+  uint16_t cnt = 0;
+  os_timer_t *curr;
+
+  for (curr = timers; curr != NULL; curr = curr->timer_next) cnt++;
+
+  return cnt;
+}
+
+bool
+system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen)
+{
+  if (prio >= USER_TASK_PRIO_MAX || tasks[prio].task != NULL || qlen == 0) return false;
+
+  tasks[prio].task = task;
+  tasks[prio].queue = queue;
+  tasks[prio].size = qlen;
+
+  return true;
+}
+
+bool
+system_os_post(uint8 prio, os_signal_t sig, os_param_t par)
+{
+  host_task *task;
+  os_event_t *e;
+
+  if (prio >= USER_TASK_PRIO_MAX) return false;
+
+  task = &tasks[prio];
+  if (task->task == NULL || task->len == task->size) return false;
+
+  e = &task->queue[(task->head + task->len) % task->size];
+  e->sig = sig;
+  e->par = par;
+  task->len++;
+
+  return true;
+}
+
+/**
+ * Fire the first armed timer.
+ */
+static void
+timer_fire(void)
+{
+  os_timer_t *ptimer = timers;
+
+  timers = ptimer->timer_next;
+  ptimer->timer_next = NULL;
+  if (ptimer->timer_period > 0) {
+    ptimer->timer_expire += ptimer->timer_period;
+    timer_link(ptimer);
+  }
+
+  ptimer->timer_func(ptimer->timer_arg);
+}
+
+/**
+ * Fire one due timer or run one task message.
+ *
+ * @return false when nothing is ready.
+ */
+static bool
+step_ready(void)
+{
+  int prio;
+  host_task *task;
+  os_event_t e;
+
+  if (timers != NULL && (int32_t) (timers->timer_expire - system_get_time()) <= 0) {
+    timer_fire();
+    return true;
+  }
+
+  for (prio = USER_TASK_PRIO_MAX - 1; prio >= 0; prio--) {
+    task = &tasks[prio];
+    if (task->len == 0) continue;
+
+    e = task->queue[task->head];
+    task->head = (uint8_t) ((task->head + 1) % task->size);
+    task->len--;
+    task->task(&e);
+
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Get time left to the first armed timer expiry.
+ *
+ * @return The time in microseconds, 0 for due timers.
+ */
+static uint64_t
+timer_wait(void)
+{
+  int32_t wait = (int32_t) (timers->timer_expire - system_get_time());
+
+  return wait > 0 ? (uint64_t) wait : 0;
+}
+
+bool
+esp_host_step(void)
+{
+  if (step_ready()) return true;
+  if (timers == NULL) return false;
+
+  // Nothing to do until the next timer.
+  clock_skip(timer_wait());
+  timer_fire();
+
+  return true;
+}
+
+void
+esp_host_advance(uint64_t us)
+{
+  uint64_t now;
+  uint64_t end = esp_host_now_us() + us;
+
+  for (;;) {
+    if (step_ready()) continue;
+
+    now = esp_host_now_us();
+    if (timers == NULL || now + timer_wait() > end) break;
+    clock_skip(timer_wait());
+  }
+
+  now = esp_host_now_us();
+  if (now < end) clock_skip(end - now);
+  while (step_ready());
+}
+
+uint32_t
+esp_host_run(uint32_t max_us)
+{
+  uint32_t steps = 0;
+  uint64_t end = esp_host_now_us() + max_us;
+
+  while (esp_host_now_us() < end && esp_host_step()) steps++;
+
+  return steps;
+}
+
+void
+system_init_done_cb(init_done_cb_t cb)
+{
+  cb();
+}
+
+void
+wifi_set_event_handler_cb(wifi_event_handler_cb_t cb)
+{
+  wifi_cb = cb;
+}
+
+void
+esp_host_wifi_event(System_Event_t *event)
+{
+  if (wifi_cb != NULL) wifi_cb(event);
+}
+
+bool
+wifi_station_disconnect(void)
+{
+  return true;
+}
+
+bool
+wifi_set_opmode(uint8 opmode)
+{
+  return true;
+}
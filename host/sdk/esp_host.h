@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Host harness control of the SDK shim.
+
+#ifndef ESP_HOST_H
+#define ESP_HOST_H
+
+#include <c_types.h>
+#include <user_interface.h>
+
+// Heap usage counters.
+typedef struct {
+  uint32_t mallocs; // Number of allocations.
+  uint32_t frees;   // Number of releases.
+  size_t used;      // Bytes in use.
+  size_t peak;      // The maximum bytes in use.
+} esp_host_mem_info;
+
+/**
+ * Mute or unmute os_printf.
+ *
+ * @param quiet Set to true to mute.
+ */
+void
+esp_host_quiet(bool quiet);
+
+/**
+ * Get current time of the shim clock.
+ *
+ * The clock runs with the host monotonic clock and is fast forwarded
+ * to the next timer expiry when there is nothing to run. In virtual
+ * mode it runs only when fast forwarded, advanced or by os_delay_us.
+ *
+ * @return The time in microseconds.
+ */
+uint64_t
+esp_host_now_us(void);
+
+/**
+ * Switch the shim clock to virtual mode or back.
+ *
+ * Virtual clock doesn't move while the code runs so callback times
+ * are exact and hours of timer activity run in milliseconds.
+ *
+ * @param on Set to true for virtual clock.
+ */
+void
+esp_host_clock_virtual(bool on);
+
+/**
+ * Append printf formatted line to the event log.
+ *
+ * @param format The format.
+ */
+void
+esp_host_log(const char *format, ...);
+
+/**
+ * Get the event log.
+ *
+ * @return The log, valid until the next esp_host_log call.
+ */
+const char *
+esp_host_log_get(void);
+
+/**
+ * Clear the event log.
+ */
+void
+esp_host_log_clear(void);
+
+/**
+ * Get heap usage counters.
+ *
+ * @param info The structure to fill.
+ */
+void
+esp_host_mem(esp_host_mem_info *info);
+
+/**
+ * Reset heap peak to the current usage.
+ */
+void
+esp_host_mem_reset_peak(void);
+
+/**
+ * Get the number of armed timers.
+ *
+ * @return The number of timers.
+ */
+uint16_t
+esp_host_timers_armed(void);
+
+/**
+ * Run one SDK task message or fire one timer.
+ *
+ * Due timers fire first, then task messages by priority. When there
+ * is nothing ready the clock is fast forwarded to the next timer.
+ *
+ * @return false when there are no messages and timers.
+ */
+bool
+esp_host_step(void);
+
+/**
+ * Advance the clock running task messages and timers on the way.
+ *
+ * Timers fire at their expiry time, timers expiring after the end
+ * are left armed. Messages posted at the end are run too.
+ *
+ * @param us The number of microseconds.
+ */
+void
+esp_host_advance(uint64_t us);
+
+/**
+ * Run task messages and timers.
+ *
+ * @param max_us Stop when clock advances by that many microseconds.
+ *
+ * @return The number of steps run.
+ */
+uint32_t
+esp_host_run(uint32_t max_us);
+
+/**
+ * Deliver WiFi event to the handler set with wifi_set_event_handler_cb.
+ *
+ * @param event The WiFi event.
+ */
+void
+esp_host_wifi_event(System_Event_t *event);
+
+#endif //ESP_HOST_H
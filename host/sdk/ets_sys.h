@@ -0,0 +1,51 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host shim of the ESP8266 NONOS SDK ets_sys.h header.
+
+#ifndef ETS_SYS_H
+#define ETS_SYS_H
+
+#include "c_types.h"
+
+#define BIT(nr) (1UL << (nr))
+
+typedef uint32_t ETSSignal;
+typedef uint32_t ETSParam;
+
+typedef struct ETSEventTag {
+  ETSSignal sig;
+  ETSParam par;
+} ETSEvent;
+
+typedef void (*ETSTask)(ETSEvent *e);
+
+typedef void ETSTimerFunc(void *timer_arg);
+
+typedef struct _ETSTIMER_ {
+  struct _ETSTIMER_ *timer_next;
+  uint32_t timer_expire;
+  uint32_t timer_period;
+  ETSTimerFunc *timer_func;
+  void *timer_arg;
+} ETSTimer;
+
+// Interrupts are never nested on the host.
+#define ETS_INTR_LOCK() do {} while(0)
+#define ETS_INTR_UNLOCK() do {} while(0)
+
+#endif //ETS_SYS_H
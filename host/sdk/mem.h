@@ -0,0 +1,34 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host shim of the ESP8266 NONOS SDK mem.h header.
+
+#ifndef MEM_H
+#define MEM_H
+
+#include <stddef.h>
+
+// Allocations are counted, see esp_host_mem().
+void *os_malloc(size_t size);
+
+void *os_zalloc(size_t size);
+
+void *os_realloc(void *ptr, size_t size);
+
+void os_free(void *ptr);
+
+#endif //MEM_H
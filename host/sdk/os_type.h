@@ -0,0 +1,32 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host shim of the ESP8266 NONOS SDK os_type.h header.
+
+#ifndef OS_TYPE_H
+#define OS_TYPE_H
+
+#include "ets_sys.h"
+
+#define os_signal_t ETSSignal
+#define os_param_t ETSParam
+#define os_event_t ETSEvent
+#define os_task_t ETSTask
+#define os_timer_t ETSTimer
+#define os_timer_func_t ETSTimerFunc
+
+#endif //OS_TYPE_H
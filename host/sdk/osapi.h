@@ -0,0 +1,49 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host shim of the ESP8266 NONOS SDK osapi.h header.
+
+#ifndef OSAPI_H
+#define OSAPI_H
+
+#include <stdio.h>
+#include <string.h>
+#include "os_type.h"
+
+#define os_memcmp memcmp
+#define os_memcpy memcpy
+#define os_memset memset
+#define os_strlen strlen
+#define os_strcmp strcmp
+#define os_strncmp strncmp
+#define os_strcpy strcpy
+#define os_sprintf sprintf
+
+// Printing is muted by esp_host_quiet().
+int os_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+void os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg);
+
+void os_timer_arm(os_timer_t *ptimer, uint32_t ms, bool repeat_flag);
+
+void os_timer_arm_us(os_timer_t *ptimer, uint32_t us, bool repeat_flag);
+
+void os_timer_disarm(os_timer_t *ptimer);
+
+void os_delay_us(uint16_t us);
+
+#endif //OSAPI_H
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host shim of the ESP8266 NONOS SDK user_interface.h header.
+
+#ifndef USER_INTERFACE_H
+#define USER_INTERFACE_H
+
+#include "os_type.h"
+#include "osapi.h"
+
+enum {
+  USER_TASK_PRIO_0 = 0,
+  USER_TASK_PRIO_1,
+  USER_TASK_PRIO_2,
+  USER_TASK_PRIO_MAX
+};
+
+#define NULL_MODE 0x00
+#define STATION_MODE 0x01
+#define SOFTAP_MODE 0x02
+#define STATIONAP_MODE 0x03
+
+struct ip_addr {
+  uint32 addr;
+};
+
+typedef enum {
+  EVENT_STAMODE_CONNECTED = 0,
+  EVENT_STAMODE_DISCONNECTED,
+  EVENT_STAMODE_AUTHMODE_CHANGE,
+  EVENT_STAMODE_GOT_IP,
+  EVENT_STAMODE_DHCP_TIMEOUT,
+  EVENT_SOFTAPMODE_STACONNECTED,
+  EVENT_SOFTAPMODE_STADISCONNECTED,
+  EVENT_SOFTAPMODE_PROBEREQRECVED,
+  EVENT_OPMODE_CHANGED,
+  EVENT_MAX
+} SYSTEM_EVENT;
+
+typedef struct {
+  uint8 ssid[32];
+  uint8 ssid_len;
+  uint8 bssid[6];
+  uint8 channel;
+} Event_StaMode_Connected_t;
+
+typedef struct {
+  uint8 ssid[32];
+  uint8 ssid_len;
+  uint8 bssid[6];
+  uint8 reason;
+} Event_StaMode_Disconnected_t;
+
+typedef struct {
+  uint8 old_mode;
+  uint8 new_mode;
+} Event_StaMode_AuthMode_Change_t;
+
+typedef struct {
+  struct ip_addr ip;
+  struct ip_addr mask;
+  struct ip_addr gw;
+} Event_StaMode_Got_IP_t;
+
+typedef struct {
+  uint8 mac[6];
+  uint8 aid;
+} Event_SoftAPMode_StaConnected_t;
+
+typedef struct {
+  uint8 mac[6];
+  uint8 aid;
+} Event_SoftAPMode_StaDisconnected_t;
+
+typedef struct {
+  int rssi;
+  uint8 mac[6];
+} Event_SoftAPMode_ProbeReqRecved_t;
+
+typedef struct {
+  uint8 old_opmode;
+  uint8 new_opmode;
+} Event_OpMode_Change_t;
+
+typedef union {
+  Event_StaMode_Connected_t connected;
+  Event_StaMode_Disconnected_t disconnected;
+  Event_StaMode_AuthMode_Change_t auth_change;
+  Event_StaMode_Got_IP_t got_ip;
+  Event_SoftAPMode_StaConnected_t sta_connected;
+  Event_SoftAPMode_StaDisconnected_t sta_disconnected;
+  Event_SoftAPMode_ProbeReqRecved_t ap_probereqrecved;
+  Event_OpMode_Change_t opmode_changed;
+} Event_Info_u;
+
+typedef struct _esp_event {
+  SYSTEM_EVENT event;
+  Event_Info_u event_info;
+} System_Event_t;
+
+typedef void (*wifi_event_handler_cb_t)(System_Event_t *event);
+
+typedef void (*init_done_cb_t)(void);
+
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+
+#define IP2STR(ipaddr) ((uint8 *) (ipaddr))[0], ((uint8 *) (ipaddr))[1], \
+                       ((uint8 *) (ipaddr))[2], ((uint8 *) (ipaddr))[3]
+#define IPSTR "%d.%d.%d.%d"
+
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen);
+
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par);
+
+uint32 system_get_time(void);
+
+uint32 system_get_free_heap_size(void);
+
+void system_init_done_cb(init_done_cb_t cb);
+
+void wifi_set_event_handler_cb(wifi_event_handler_cb_t cb);
+
+bool wifi_station_disconnect(void);
+
+bool wifi_set_opmode(uint8 opmode);
+
+#endif //USER_INTERFACE_H
@@ -0,0 +1,704 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Timer behaviour tests on the shim virtual clock.
+//
+// Usage: tim_sim [-t test]
+//
+// Every test runs simulated time with esp_host_advance and compares the
+// event log (times relative to the test start) with the expected one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <osapi.h>
+#include "esp_host.h"
+#include "esp_co.h"
+#include "esp_eb.h"
+#include "esp_tim.h"
+
+// Simulated time of the periodic test.
+#define SIM_HOURS 3
+#define SIM_HOUR_US 3600000000ULL
+
+typedef struct {
+  const char *name;
+  bool (*run)(void);
+} sim_test;
+
+static uint32_t t0;
+static esp_tim_mux mux;
+static esp_tim_mux_timer mtimers[3];
+static uint32_t fires;
+static bool fire_late;
+
+static void
+sim_log(const char *what, uint32_t value)
+{
+  esp_host_log("%u %s %u\n", system_get_time() - t0, what, value);
+}
+
+/**
+ * Start the test: clear the log and mark the start time.
+ */
+static void
+sim_begin(void)
+{
+  esp_host_log_clear();
+  esp_tim_mux_init(&mux, NULL);
+  t0 = system_get_time();
+  fires = 0;
+}
+
+/**
+ * Compare the log with expected one.
+ *
+ * @param expected The expected log.
+ *
+ * @return true if equal and no timers are left armed.
+ */
+static bool
+sim_end(const char *expected)
+{
+  if (expected != NULL && strcmp(esp_host_log_get(), expected) != 0) {
+    fprintf(stderr, "expected:\n%sgot:\n%s", expected, esp_host_log_get());
+    return false;
+  }
+  if (esp_host_timers_armed() != 0) {
+    fprintf(stderr, "%u timers still armed\n", esp_host_timers_armed());
+    return false;
+  }
+
+  return true;
+}
+
+static void
+periodic_cb(void *arg)
+{
+  esp_tim_mux_timer *timer = arg;
+
+  // Deadlines are absolute so every call is exactly on the 10 ms grid
+  // even after the 32 bit clock wraps around.
+  fires++;
+  if (system_get_time() - t0 != (uint32_t) (fires * 10000ULL)) fire_late = true;
+  if (fires == (uint32_t) (SIM_HOURS * SIM_HOUR_US / 10000)) esp_tim_mux_disarm(timer);
+}
+
+static bool
+test_periodic(void)
+{
+  sim_begin();
+  fire_late = false;
+  esp_tim_mux_setfn(&mtimers[0], periodic_cb, NULL);
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 10000, ESP_TIM_SKIP);
+  esp_host_advance(SIM_HOURS * SIM_HOUR_US);
+
+  printf("periodic: %u calls in %d simulated hours\n", fires, SIM_HOURS);
+  if (fire_late || esp_tim_mux_overruns(&mtimers[0]) != 0) {
+    fprintf(stderr, "periodic timer drifted\n");
+    return false;
+  }
+
+  return sim_end(NULL);
+}
+
+static void
+overrun_cb(void *arg)
+{
+  esp_tim_mux_timer *timer = arg;
+
+  sim_log("fire", esp_tim_mux_overruns(timer));
+  if (++fires == 2) os_delay_us(25000);
+}
+
+static bool
+test_overrun(void)
+{
+  sim_begin();
+  esp_tim_mux_setfn(&mtimers[0], overrun_cb, NULL);
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 10000, ESP_TIM_CATCH_UP);
+  esp_host_advance(60000);
+  esp_tim_mux_disarm(&mtimers[0]);
+
+  esp_host_log("skip\n");
+  fires = 0;
+  t0 = system_get_time();
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 10000, ESP_TIM_SKIP);
+  esp_host_advance(60000);
+  esp_tim_mux_disarm(&mtimers[0]);
+
+  return sim_end("10000 fire 0\n"
+                 "20000 fire 0\n"
+                 "45000 fire 1\n"
+                 "45000 fire 1\n"
+                 "50000 fire 1\n"
+                 "60000 fire 1\n"
+                 "skip\n"
+                 "10000 fire 0\n"
+                 "20000 fire 0\n"
+                 "45000 fire 1\n"
+                 "50000 fire 1\n"
+                 "60000 fire 1\n");
+}
+
+static void
+slack_cb(void *arg)
+{
+  esp_tim_mux_timer *timer = arg;
+
+  sim_log("timer", (uint32_t) (size_t) timer->payload);
+}
+
+static bool
+test_slack(void)
+{
+  uint8_t idx;
+
+  sim_begin();
+  for (idx = 0; idx < 3; idx++) {
+    esp_tim_mux_setfn(&mtimers[idx], slack_cb, (void *) (size_t) idx);
+    esp_tim_mux_set_slack(&mtimers[idx], 5000);
+    esp_tim_mux_arm(&mux, &mtimers[idx], 10000 + idx * 2000);
+  }
+  esp_host_advance(30000);
+  sim_log("saved", esp_tim_mux_saved(&mux));
+
+  return sim_end("15000 timer 0\n"
+                 "15000 timer 1\n"
+                 "15000 timer 2\n"
+                 "30000 saved 2\n");
+}
+
+static bool
+test_reslack(void)
+{
+  uint8_t idx;
+
+  // Slack set on armed timer moves it in the heap and the wakeup.
+  sim_begin();
+  for (idx = 0; idx < 3; idx++) {
+    esp_tim_mux_setfn(&mtimers[idx], slack_cb, (void *) (size_t) idx);
+    esp_tim_mux_arm(&mux, &mtimers[idx], 10000 + idx * 2000);
+  }
+  esp_tim_mux_set_slack(&mtimers[0], 5000);
+  esp_host_advance(30000);
+  sim_log("saved", esp_tim_mux_saved(&mux));
+
+  return sim_end("12000 timer 1\n"
+                 "12000 timer 0\n"
+                 "14000 timer 2\n"
+                 "30000 saved 1\n");
+}
+
+static void
+continue_cb(void *arg)
+{
+  esp_tim_timer *timer = arg;
+
+  sim_log("continue", 0);
+  os_delay_us(1000);
+  if (++fires < 4) esp_tim_continue(timer);
+}
+
+static void
+grid_cb(void *arg)
+{
+  sim_log("periodic", 0);
+  os_delay_us(1000);
+}
+
+static bool
+test_drift(void)
+{
+  esp_tim_timer timer;
+
+  // Rearming from callback drifts by the callback duration, periodic
+  // multiplexed timer doesn't.
+  sim_begin();
+  esp_tim_init(&timer, continue_cb, NULL, 10);
+  esp_tim_arm(&timer);
+  esp_host_advance(45000);
+
+  esp_tim_mux_setfn(&mtimers[0], grid_cb, NULL);
+  t0 = system_get_time();
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 10000, ESP_TIM_SKIP);
+  esp_host_advance(40000);
+  esp_tim_mux_disarm(&mtimers[0]);
+
+  return sim_end("10000 continue 0\n"
+                 "21000 continue 0\n"
+                 "32000 continue 0\n"
+                 "43000 continue 0\n"
+                 "10000 periodic 0\n"
+                 "20000 periodic 0\n"
+                 "30000 periodic 0\n"
+                 "40000 periodic 0\n");
+}
+
+#ifdef ESP_TIM_STATS_ON
+
+static void
+busy_cb(void *arg)
+{
+  // The first call runs 3 ms, the next ones 1 ms.
+  os_delay_us(fires++ == 0 ? 3000 : 1000);
+}
+
+static void
+stop_cb(void *arg)
+{
+  esp_tim_timer *timer = arg;
+
+  // Released after the statistics are updated.
+  sim_log("stop", timer->stats.calls);
+  esp_tim_stop(timer);
+}
+
+static void
+stats_log(const char *what, const esp_tim_stats *stats)
+{
+  esp_host_log("%s calls %u late %u-%u run %u-%u avg %u\n", what, stats->calls,
+               stats->late.min, stats->late.max, stats->run.min, stats->run.max,
+               stats->run.sum / stats->calls);
+}
+
+static bool
+test_stats(void)
+{
+  esp_tim_timer timer;
+
+  sim_begin();
+  esp_tim_mux_setfn(&mtimers[0], busy_cb, NULL);
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 10000, ESP_TIM_SKIP);
+  esp_host_advance(30000);
+  esp_tim_mux_disarm(&mtimers[0]);
+  stats_log("mux", &mtimers[0].stats);
+
+  fires = 0;
+  esp_tim_init(&timer, busy_cb, NULL, 10);
+  esp_tim_arm(&timer);
+  esp_host_advance(10000);
+  stats_log("sdk", &timer.stats);
+
+  esp_tim_start_delay(stop_cb, NULL, 10);
+  esp_host_advance(10000);
+
+  return sim_end("mux calls 3 late 0-0 run 1000-3000 avg 1666\n"
+                 "sdk calls 1 late 0-0 run 3000-3000 avg 3000\n"
+                 "54000 stop 1\n");
+}
+
+#endif
+
+static void
+us_cb(void *arg)
+{
+  esp_tim_us_timer *timer = arg;
+
+  sim_log("us", timer->delay);
+  if (++fires < 3) {
+    esp_tim_arm_us(timer);
+    return;
+  }
+  esp_tim_stop_us(timer);
+}
+
+static bool
+test_us(void)
+{
+  esp_tim_us_info info;
+
+  sim_begin();
+  esp_tim_us_info_reset();
+  // Shorter than ESP_TIM_US_MIN, rounded up and 70 us late.
+  esp_tim_start_delay_us(us_cb, NULL, 30);
+  esp_host_advance(1000);
+  fires = 0;
+  esp_tim_start_delay_us(us_cb, NULL, 250);
+  esp_host_advance(1000);
+
+  esp_tim_us_info_get(&info);
+  sim_log("fired", info.fired);
+  sim_log("late_max", info.late_max_us);
+  sim_log("min_delay", info.min_delay_us);
+
+  return sim_end("100 us 30\n"
+                 "200 us 30\n"
+                 "300 us 30\n"
+                 "1250 us 250\n"
+                 "1500 us 250\n"
+                 "1750 us 250\n"
+                 "2000 fired 6\n"
+                 "2000 late_max 70\n"
+                 "2000 min_delay 100\n");
+}
+
+static esp_eb_id sim_event;
+
+static void
+throttled_cb(const char *event, void *arg)
+{
+  sim_log("delivered", (uint32_t) (size_t) arg);
+}
+
+static void
+trigger_cb(void *arg)
+{
+  esp_eb_trigger_sync_id(sim_event, (void *) (size_t) ++fires);
+}
+
+static bool
+test_throttle(void)
+{
+  sim_begin();
+  sim_event = esp_eb_register("simThr");
+  esp_eb_attach_throttled_id(sim_event, throttled_cb, 100000);
+
+  // Trigger every 30 ms, deliver at most every 100 ms.
+  esp_tim_mux_setfn(&mtimers[0], trigger_cb, NULL);
+  esp_tim_mux_arm_periodic(&mux, &mtimers[0], 30000, ESP_TIM_SKIP);
+  esp_host_advance(300000);
+  esp_tim_mux_disarm(&mtimers[0]);
+  esp_eb_detach_id(sim_event, throttled_cb);
+
+  return sim_end("30000 delivered 1\n"
+                 "150000 delivered 5\n"
+                 "270000 delivered 9\n");
+}
+
+static void
+batch_cb(const char *event, void *arg)
+{
+  sim_log(event, (uint32_t) (size_t) arg);
+}
+
+static void
+late_cb(const char *event, void *arg)
+{
+  sim_log("late", (uint32_t) (size_t) arg);
+}
+
+static bool
+test_batch(void)
+{
+  esp_eb_id ev_a, ev_b;
+  uint16_t cancelled;
+  esp_eb_trigger_req reqs[2];
+
+  sim_begin();
+  ev_a = esp_eb_register("simA");
+  ev_b = esp_eb_register("simB");
+  esp_eb_attach_id(ev_a, batch_cb);
+  esp_eb_attach_id(ev_b, batch_cb);
+
+  // Batch keeps its place among separate triggers and
+  // subscribers attached after the call get nothing.
+  esp_eb_trigger_id(ev_a, (void *) 1);
+  reqs[0].id = ev_b;
+  reqs[0].arg = (void *) 2;
+  reqs[1].id = ev_a;
+  reqs[1].arg = (void *) 3;
+  esp_eb_trigger_batch(reqs, 2);
+  esp_eb_trigger_id(ev_b, (void *) 4);
+  esp_eb_attach_id(ev_a, late_cb);
+  esp_host_advance(30000);
+
+  // Batched deliveries are cancelled like any other.
+  reqs[0].arg = (void *) 5;
+  esp_eb_trigger_batch(reqs, 2);
+  cancelled = esp_eb_cancel_delayed_id(ev_b);
+  esp_host_advance(30000);
+  sim_log("cancelled", cancelled);
+
+  esp_eb_detach_id(ev_a, batch_cb);
+  esp_eb_detach_id(ev_a, late_cb);
+  esp_eb_detach_id(ev_b, batch_cb);
+
+  return sim_end("10000 simA 1\n"
+                 "10000 simB 2\n"
+                 "10000 simA 3\n"
+                 "10000 simB 4\n"
+                 "40000 simA 3\n"
+                 "40000 late 3\n"
+                 "60000 cancelled 1\n");
+}
+
+static bool
+test_wheel(void)
+{
+  esp_eb_id ev_a;
+
+  sim_begin();
+  ev_a = esp_eb_register("simA");
+  esp_eb_attach_id(ev_a, batch_cb);
+
+  // Triggers without delay go at the next tick, delayed ones
+  // at the first tick not earlier than the delay.
+  esp_eb_trigger_id(ev_a, (void *) 1);
+  esp_host_advance(3000);
+  esp_eb_trigger_id(ev_a, (void *) 2);
+  esp_eb_trigger_delayed_id(ev_a, 10, (void *) 3);
+  esp_eb_trigger_delayed_id(ev_a, 7, (void *) 4);
+  esp_host_advance(30000);
+  esp_eb_detach_id(ev_a, batch_cb);
+
+  return sim_end("10000 simA 1\n"
+                 "10000 simA 2\n"
+                 "10000 simA 4\n"
+                 "20000 simA 3\n");
+}
+
+static bool
+test_coalesce(void)
+{
+  esp_eb_id ev_a, ev_b;
+  uint32_t idx;
+
+  // Triggers at 0, 10 and 20 ms. Coalesced subscriber gets the newest
+  // payload at the end of the first window, debounced one 50 ms after
+  // the last trigger.
+  sim_begin();
+  ev_a = esp_eb_register("simA");
+  ev_b = esp_eb_register("simB");
+  esp_eb_attach_coalesced_id(ev_a, batch_cb, 50000);
+  esp_eb_attach_debounced_id(ev_b, batch_cb, 50000);
+  for (idx = 1; idx <= 3; idx++) {
+    esp_eb_trigger_sync_id(ev_a, (void *) (size_t) idx);
+    esp_eb_trigger_sync_id(ev_b, (void *) (size_t) idx);
+    esp_host_advance(10000);
+  }
+  esp_host_advance(100000);
+  esp_eb_detach_id(ev_a, batch_cb);
+  esp_eb_detach_id(ev_b, batch_cb);
+
+  return sim_end("50000 simA 3\n"
+                 "70000 simB 3\n");
+}
+
+static void
+got_ip_cb(const char *event, void *arg)
+{
+  Event_StaMode_Got_IP_t *info = arg;
+
+  sim_log("ip", info->ip.addr);
+}
+
+static bool
+test_wifi(void)
+{
+  System_Event_t event;
+
+  // The SDK reuses the event structure after the handler returns,
+  // subscribers called later must get a copy.
+  sim_begin();
+  esp_eb_handle_wifi_events();
+  esp_eb_attach(ESP_EB_EVENT_STAMODE_GOT_IP, got_ip_cb);
+
+  os_memset(&event, 0, sizeof(event));
+  event.event = EVENT_STAMODE_GOT_IP;
+  event.event_info.got_ip.ip.addr = 0x0A00000A;
+  esp_host_wifi_event(&event);
+  event.event_info.got_ip.ip.addr = 0;
+  esp_host_advance(20000);
+  esp_eb_detach(ESP_EB_EVENT_STAMODE_GOT_IP, got_ip_cb);
+
+  return sim_end("10000 ip 167772170\n");
+}
+
+static esp_co_state
+sim_co(esp_co *co)
+{
+  ESP_CO_BEGIN(co);
+  ESP_CO_SLEEP_MS(co, 10);
+  sim_log("slept", 10);
+  ESP_CO_SLEEP_MS(co, 20);
+  sim_log("slept", 20);
+  ESP_CO_SLEEP_MS(co, 40);
+  sim_log("slept", 40);
+  ESP_CO_WAIT_EVENT(co, sim_event);
+  sim_log("event", (uint32_t) (size_t) co->event_arg);
+  ESP_CO_END(co);
+}
+
+static void
+event_cb(void *arg)
+{
+  esp_eb_trigger_sync_id(sim_event, (void *) 7);
+}
+
+static bool
+test_coroutine(void)
+{
+  esp_co co;
+
+  sim_begin();
+  sim_event = esp_eb_register("simCo");
+  esp_co_init(&co, sim_co, NULL);
+  esp_co_start(&co);
+
+  esp_tim_mux_setfn(&mtimers[0], event_cb, NULL);
+  esp_tim_mux_arm(&mux, &mtimers[0], 100000);
+  esp_host_advance(200000);
+  if (esp_co_running(&co)) {
+    fprintf(stderr, "coroutine didn't end\n");
+    return false;
+  }
+
+  return sim_end("10000 slept 10\n"
+                 "30000 slept 20\n"
+                 "70000 slept 40\n"
+                 "100000 event 7\n");
+}
+
+static esp_co_state
+waiter_co(esp_co *co)
+{
+  ESP_CO_BEGIN(co);
+  ESP_CO_WAIT_EVENT(co, *(esp_eb_id *) co->payload);
+  sim_log(esp_eb_name(*(esp_eb_id *) co->payload), (uint32_t) (size_t) co->event_arg);
+  ESP_CO_END(co);
+}
+
+static bool
+test_co_events(void)
+{
+  esp_co co_a, co_b;
+  esp_eb_id ev_a, ev_b;
+
+  // Waiters of other events stay asleep, timer mode
+  // trigger resumes at the next wheel tick.
+  sim_begin();
+  ev_a = esp_eb_register("simA");
+  ev_b = esp_eb_register("simB");
+  esp_co_init(&co_a, waiter_co, &ev_a);
+  esp_co_init(&co_b, waiter_co, &ev_b);
+  esp_co_start(&co_a);
+  esp_co_start(&co_b);
+
+  esp_eb_trigger_sync_id(ev_b, (void *) 2);
+  esp_eb_trigger_id(ev_a, (void *) 1);
+  esp_host_advance(20000);
+  if (esp_co_running(&co_a) || esp_co_running(&co_b)) {
+    fprintf(stderr, "coroutine didn't end\n");
+    return false;
+  }
+
+  return sim_end("0 simB 2\n"
+                 "10000 simA 1\n");
+}
+
+static void
+co_trigger_cb(void *arg)
+{
+  esp_eb_trigger_id(sim_event, (void *) 2);
+}
+
+static esp_co_state
+trigger_co(esp_co *co)
+{
+  ESP_CO_BEGIN(co);
+  // Dropped, nobody waits for the event yet.
+  esp_eb_trigger_delayed_id(sim_event, 20, (void *) 1);
+  // The pattern from the coroutine example.
+  esp_tim_mux_arm(&mux, &mtimers[0], 50000);
+  ESP_CO_WAIT_EVENT(co, sim_event);
+  sim_log("event", (uint32_t) (size_t) co->event_arg);
+  ESP_CO_END(co);
+}
+
+static bool
+test_co_trigger(void)
+{
+  esp_co co;
+
+  sim_begin();
+  sim_event = esp_eb_register("simCoTrg");
+  esp_tim_mux_setfn(&mtimers[0], co_trigger_cb, NULL);
+  esp_co_init(&co, trigger_co, NULL);
+  esp_co_start(&co);
+  esp_host_advance(100000);
+  if (esp_co_running(&co)) {
+    fprintf(stderr, "coroutine didn't end\n");
+    return false;
+  }
+
+  return sim_end("60000 event 2\n");
+}
+
+static const sim_test tests[] = {
+  {"periodic", test_periodic},
+  {"overrun", test_overrun},
+  {"slack", test_slack},
+  {"reslack", test_reslack},
+  {"drift", test_drift},
+  {"us", test_us},
+  {"throttle", test_throttle},
+  {"coroutine", test_coroutine},
+  {"co_events", test_co_events},
+  {"co_trigger", test_co_trigger},
+  {"batch", test_batch},
+  {"wheel", test_wheel},
+  {"coalesce", test_coalesce},
+  {"wifi", test_wifi},
+#ifdef ESP_TIM_STATS_ON
+  {"stats", test_stats},
+#endif
+};
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-t test]\n", prog);
+  exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt;
+  size_t idx;
+  const char *only = NULL;
+  bool found = false;
+
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    switch (opt) {
+      case 't': only = optarg; break;
+      default: usage(argv[0]);
+    }
+  }
+
+  esp_host_quiet(true);
+  esp_host_clock_virtual(true);
+  // The clock starts near zero like on the device, leave esp_eb
+  // throttle windows (counted from zero) behind.
+  esp_host_advance(1000000);
+
+  for (idx = 0; idx < sizeof(tests) / sizeof(tests[0]); idx++) {
+    if (only != NULL && strcmp(only, tests[idx].name) != 0) continue;
+    found = true;
+    if (!tests[idx].run()) {
+      fprintf(stderr, "%s: FAIL\n", tests[idx].name);
+      return 1;
+    }
+    printf("%s: OK\n", tests[idx].name);
+  }
+
+  if (!found) usage(argv[0]);
+
+  return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <osapi.h>
+#include "include/esp_co.h"
+
+// Awaited event marked for resume (event IDs are small).
+#define ESP_CO_WOKEN_BIT 0x8000
+#define ESP_CO_WOKEN(id) ((esp_eb_id) ((id) | ESP_CO_WOKEN_BIT))
+
+// Multiplexer of coroutine sleep timers.
+static esp_tim_mux co_mux;
+static bool co_mux_ready;
+
+// Coroutines waiting for events.
+static esp_co *waiters;
+
+
+/**
+ * Resume coroutine.
+ *
+ * @param co The coroutine.
+ */
+static void ICACHE_FLASH_ATTR
+co_resume(esp_co *co)
+{
+  if (co->fn(co) == ESP_CO_ENDED) co->_line = 0;
+}
+
+/**
+ * Sleep timer callback.
+ *
+ * @param arg The expired timer.
+ */
+static void ICACHE_FLASH_ATTR
+co_timer_cb(void *arg)
+{
+  esp_tim_mux_timer *timer = arg;
+
+  co_resume(timer->payload);
+}
+
+/**
+ * Remove coroutine from event waiters.
+ *
+ * @param co The coroutine.
+ */
+static void ICACHE_FLASH_ATTR
+waiters_remove(esp_co *co)
+{
+  esp_co **link = &waiters;
+
+  while (*link != NULL && *link != co) link = &(*link)->_next;
+  if (*link != NULL) *link = co->_next;
+
+  co->_next = NULL;
+  co->_event = ESP_EB_ID_INVALID;
+}
+
+/**
+ * Check if any coroutine waits for event.
+ *
+ * @param id The event ID.
+ *
+ * @return true if event has waiters.
+ */
+static bool ICACHE_FLASH_ATTR
+waiters_has(esp_eb_id id)
+{
+  esp_co *curr;
+
+  for (curr = waiters; curr != NULL; curr = curr->_next) {
+    if (curr->_event == id) return true;
+  }
+
+  return false;
+}
+
+/**
+ * Event callback resuming all coroutines waiting for the event.
+ *
+ * @param event The event name.
+ * @param arg   The event argument.
+ */
+static void ICACHE_FLASH_ATTR
+co_event_cb(const char *event, void *arg)
+{
+  esp_eb_id id = ESP_EB_ID_INVALID;
+  esp_co *co;
+
+  // Subscribers get the registered name, compare pointers
+  // instead of looking the name up.
+  for (co = waiters; co != NULL && id == ESP_EB_ID_INVALID; co = co->_next) {
+    if (esp_eb_name(co->_event) == event) id = co->_event;
+  }
+  if (id == ESP_EB_ID_INVALID) return;
+
+  // Mark waiters first, resumed coroutines may wait for the event again.
+  for (co = waiters; co != NULL; co = co->_next) {
+    if (co->_event == id) co->_event = ESP_CO_WOKEN(id);
+  }
+
+  // Coroutines stopped by resumed ones are not on the list anymore.
+  for (co = waiters; co != NULL;) {
+    if (co->_event != ESP_CO_WOKEN(id)) {
+      co = co->_next;
+      continue;
+    }
+
+    waiters_remove(co);
+    co->event_arg = arg;
+    co_resume(co);
+    co = waiters;
+  }
+
+  if (!waiters_has(id)) esp_eb_detach_id(id, co_event_cb);
+}
+
+void ICACHE_FLASH_ATTR
+esp_co_init(esp_co *co, esp_co_fn *fn, void *payload)
+{
+  os_memset(co, 0, sizeof(esp_co));
+  co->fn = fn;
+  co->payload = payload;
+  co->_event = ESP_EB_ID_INVALID;
+  esp_tim_mux_setfn(&co->_timer, co_timer_cb, co);
+}
+
+void ICACHE_FLASH_ATTR
+esp_co_start(esp_co *co)
+{
+  if (co->_line != 0) return;
+  co_resume(co);
+}
+
+void ICACHE_FLASH_ATTR
+esp_co_stop(esp_co *co)
+{
+  esp_eb_id id = (esp_eb_id) (co->_event & ~ESP_CO_WOKEN_BIT);
+
+  esp_tim_mux_disarm(&co->_timer);
+  if (co->_event != ESP_EB_ID_INVALID) {
+    waiters_remove(co);
+    if (!waiters_has(id)) esp_eb_detach_id(id, co_event_cb);
+  }
+
+  co->_line = 0;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_co_running(const esp_co *co)
+{
+  return co->_line != 0;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_co_sleep_ms(esp_co *co, uint32_t ms)
+{
+  if (!co_mux_ready) {
+    esp_tim_mux_init(&co_mux, NULL);
+    co_mux_ready = true;
+  }
+
+  if (ms > ESP_TIM_MUX_MAX_DELAY_US / 1000) ms = ESP_TIM_MUX_MAX_DELAY_US / 1000;
+
+  return esp_tim_mux_arm(&co_mux, &co->_timer, ms * 1000);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_co_wait_event(esp_co *co, esp_eb_id id)
+{
+  esp_co **link = &waiters;
+  esp_eb_err err = esp_eb_attach_id(id, co_event_cb);
+  if (err != ESP_EB_ATTACH_OK && err != ESP_EB_ATTACH_EXISTED) return false;
+
+  co->_event = id;
+  co->_next = NULL;
+  while (*link != NULL) link = &(*link)->_next;
+  *link = co;
+
+  return true;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_CO_H
+#define ESP_CO_H
+
+#include <c_types.h>
+#include "esp_eb.h"
+#include "esp_tim.h"
+
+
+// Coroutine body return values.
+typedef enum {
+  ESP_CO_WAITING, // Waits for timer or event.
+  ESP_CO_ENDED    // Finished, esp_co_start may run it again.
+} esp_co_state;
+
+typedef struct esp_co esp_co;
+
+// The coroutine body prototype.
+typedef esp_co_state (esp_co_fn)(esp_co *co);
+
+// Stackless coroutine (protothread).
+//
+// Local variables of the coroutine body are not preserved between
+// waits, keep state in the payload.
+struct esp_co {
+  esp_co_fn *fn;                // The coroutine body.
+  void *payload;                // The payload.
+  void *event_arg;              // The argument of the event which resumed the coroutine.
+  esp_tim_mux_timer _timer;     // Sleep timer. Don't touch it.
+  esp_co *_next;                // The next event waiter. Don't touch it.
+  esp_eb_id _event;             // The awaited event. Don't touch it.
+  uint16_t _line;               // The resume point. Don't touch it.
+};
+
+// Begin coroutine body.
+#define ESP_CO_BEGIN(co) switch ((co)->_line) { case 0:
+
+// End coroutine body.
+#define ESP_CO_END(co) } (co)->_line = 0; return ESP_CO_ENDED
+
+// Return from coroutine body and resume at this point.
+#define ESP_CO_SUSPEND(co) \
+  (co)->_line = __LINE__; return ESP_CO_WAITING; case __LINE__:;
+
+// Resume coroutine body after ms milliseconds. Ends the coroutine
+// when ESP_TIM_MUX_SIZE coroutines already sleep.
+#define ESP_CO_SLEEP_MS(co, ms) do { \
+    if (!esp_co_sleep_ms((co), (ms))) ESP_CO_EXIT(co); \
+    ESP_CO_SUSPEND(co); \
+  } while (0)
+
+// Let other tasks run and resume coroutine body as soon as possible.
+#define ESP_CO_YIELD(co) ESP_CO_SLEEP_MS((co), 0)
+
+// Resume coroutine body when event is triggered. The event argument
+// is available in event_arg field. The coroutine is resumed when
+// subscribers are called so esp_eb_trigger resumes it at the next
+// esp_eb timing wheel tick (up to ESP_EB_TIMER_MS later), use
+// esp_eb_trigger_sync or esp_eb_trigger_asap to resume it sooner.
+// esp_eb resolves subscribers when the event is triggered so triggers
+// made before the wait, also delayed ones, never resume it.
+// Ends the coroutine when the event can't be subscribed to.
+#define ESP_CO_WAIT_EVENT(co, id) do { \
+    if (!esp_co_wait_event((co), (id))) ESP_CO_EXIT(co); \
+    ESP_CO_SUSPEND(co); \
+  } while (0)
+
+// End coroutine.
+#define ESP_CO_EXIT(co) do { (co)->_line = 0; return ESP_CO_ENDED; } while (0)
+
+
+/**
+ * Initialize coroutine.
+ *
+ * Never allocates memory. The storage must stay valid until
+ * the coroutine ends or is stopped.
+ *
+ * @param co      The coroutine.
+ * @param fn      The coroutine body.
+ * @param payload The payload.
+ */
+void ICACHE_FLASH_ATTR
+esp_co_init(esp_co *co, esp_co_fn *fn, void *payload);
+
+/**
+ * Run coroutine body from the beginning until the first wait.
+ *
+ * Does nothing if coroutine is already running.
+ *
+ * @param co The coroutine.
+ */
+void ICACHE_FLASH_ATTR
+esp_co_start(esp_co *co);
+
+/**
+ * Stop coroutine.
+ *
+ * Cancels pending sleep or event wait. Use ESP_CO_EXIT inside
+ * the coroutine body instead.
+ *
+ * @param co The coroutine.
+ */
+void ICACHE_FLASH_ATTR
+esp_co_stop(esp_co *co);
+
+/**
+ * Check if coroutine is waiting to be resumed.
+ *
+ * @param co The coroutine.
+ *
+ * @return true if running.
+ */
+bool ICACHE_FLASH_ATTR
+esp_co_running(const esp_co *co);
+
+/**
+ * Schedule coroutine resume after ms milliseconds.
+ *
+ * Used by ESP_CO_SLEEP_MS.
+ *
+ * @param co The coroutine.
+ * @param ms The delay in milliseconds.
+ *
+ * @return true on success, false if there are too many sleeping coroutines.
+ */
+bool ICACHE_FLASH_ATTR
+esp_co_sleep_ms(esp_co *co, uint32_t ms);
+
+/**
+ * Schedule coroutine resume on event.
+ *
+ * Used by ESP_CO_WAIT_EVENT.
+ *
+ * @param co The coroutine.
+ * @param id The event ID.
+ *
+ * @return true on success, false on unknown event or out of memory.
+ */
+bool ICACHE_FLASH_ATTR
+esp_co_wait_event(esp_co *co, esp_eb_id id);
+
+#endif //ESP_CO_H
@@ -23,6 +23,9 @@
 #   esp_eb_LIBRARY      - The path to the library.
 #   esp_eb_LIBRARIES    - The dependencies to link to use the library.
 #                          It will have a form of <lib_name>_LIBRARY [dep1_name_LIBRARIES, ...].
+#   esp_eb_DEFINITIONS  - Compiler definitions the library was built with
+#                          (taken from ESP_EB_STATS_ON and ESP_EB_TRACE_ON
+#                          environment variables). Added with add_definitions.
 #
 
 
@@ -51,3 +54,13 @@ set(esp_eb_LIBRARIES
     ${esp_eb_LIBRARY}
     ${esp_tim_LIBRARIES}
     ${esp_util_LIBRARIES})
+
+# Must match the library build.
+set(esp_eb_DEFINITIONS)
+if($ENV{ESP_EB_STATS_ON})
+  list(APPEND esp_eb_DEFINITIONS -DESP_EB_STATS_ON)
+endif()
+if($ENV{ESP_EB_TRACE_ON})
+  list(APPEND esp_eb_DEFINITIONS -DESP_EB_TRACE_ON)
+endif()
+add_definitions(${esp_eb_DEFINITIONS})
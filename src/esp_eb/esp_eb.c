@@ -24,354 +24,2223 @@
 #include "esp_eb_internal.h"
 
 
-// Structure defining event.
+// Reference counted copy of trigger argument.
 typedef struct {
-  char *name;           // Event name.
+  uint16_t refs; // The number of deliveries using the copy.
+  uint16_t size; // The size of data.
+  uint8_t data[];
+} eb_buf;
+
+// Trigger payload.
+typedef struct {
+  void *arg;   // Passed to callbacks.
+  eb_buf *buf; // The arg copy owner (NULL if arg is not copied).
+#ifdef ESP_EB_STATS_ON
+  uint32_t ttime_us; // Trigger time.
+#endif
+} eb_msg;
+
+// Subscriber handle: handle table index (low 16 bits)
+// and the index generation (high 16 bits).
+typedef uint32_t eb_sub;
+
+// Structure defining scheduled event delivery (timing wheel entry).
+typedef struct event {
+  esp_eb_id id;        // Event ID.
+  eb_sub sub;          // The subscriber (ESP_EB_SUB_INVALID when cancelled).
+  eb_msg msg;          // Passed to callback.
+  uint32_t deadline;   // The wheel tick to deliver at.
+  struct event *next;  // The next entry in the same wheel slot.
+} eb_event;
+
+// Timing wheel entries with the same deadline added in one pass.
+typedef struct {
+  eb_event *head;    // The first entry.
+  eb_event *tail;    // The last entry.
+  uint16_t cnt;      // The number of entries.
+  uint32_t deadline; // The wheel tick to deliver at.
+} eb_batch;
+
+// Structure defining queued event trigger.
+typedef struct {
+  esp_eb_id id; // Event ID.
+  eb_msg msg;   // Passed to callbacks.
+} eb_trigger;
+
+#ifdef ESP_EB_TRACE_ON
+// Trace entry (8 bytes).
+typedef struct {
+  uint32_t ts_us; // The time of the record.
+  esp_eb_id id;   // Event ID.
+  uint16_t info;  // Phase (2 high bits) and subscriber handle index.
+} eb_trace;
+#endif
+
+// WiFi event bridge entry.
+typedef struct {
+  esp_eb_id id; // Event ID.
+  uint8_t size; // The size of event_info member passed to subscribers.
+} eb_wifi;
+
+// Structure defining trigger from interrupt handler.
+typedef struct {
+  esp_eb_id id;   // Event ID.
+  uint32_t value; // Passed to callbacks as arg.
+#ifdef ESP_EB_STATS_ON
+  uint32_t ttime_us; // Trigger time.
+#endif
+} eb_isr;
+
+// Dispatcher queue lane.
+typedef struct {
+  eb_trigger *items; // Ring buffer.
+  uint16_t size;     // Ring buffer capacity.
+  uint16_t head;     // Index of the oldest trigger.
+  uint16_t len;      // Number of queued triggers.
+  uint32_t dropped;  // Number of triggers dropped because lane was full.
+} eb_lane;
+
+// Deferred delivery of debounced and coalesced subscribers.
+typedef struct {
+  os_timer_t timer;   // Fires at the end of the window.
+  esp_eb_id id;       // Event ID.
+  uint32_t window_ms; // The window length.
+  bool debounce;      // Restart window on every trigger.
+  bool armed;         // Is delivery pending.
+  eb_msg msg;         // The newest payload.
+} eb_pending;
+
+// Linked list of event subscribers.
+typedef struct node {
   esp_eb_cb *cb;        // Event callback function.
   uint32_t ctime_us;    // Last time callback was called.
   uint32_t throttle_us; // Throttle callback calls (0 - no throttle).
   // The minimum number of microseconds to wait between callback executions.
-  void *payload;        // Passed to callback.
-} eb_event;
+  eb_pending *pending;  // Set for debounced and coalesced subscribers.
+  eb_sub sub;           // The subscriber handle.
+  struct node *next;    // The pointer to the next node on the list.
+} eb_node;
+
+// Subscriber handle table entry.
+typedef struct {
+  eb_node *node; // The subscriber or NULL if entry is free.
+  uint16_t gen;  // Incremented every time entry is released.
+  uint16_t next; // The next free entry.
+} eb_handle;
+
+// Registered event.
+typedef struct name {
+  const char *name;  // Event name.
+  uint32_t hash;     // Event name hash.
+  esp_eb_id id;      // Event ID.
+  uint8_t prio;      // Dispatcher queue lane (esp_eb_prio).
+  uint32_t wild;     // Matching wildcard subscriptions (bit per wilds slot).
+  eb_node *head;     // Subscribers in order of attaching.
+  bool dirty;        // Has subscribers detached during dispatch.
+  struct name *next; // The next name in the same bucket.
+#ifdef ESP_EB_STATS_ON
+  esp_eb_stats stats;
+#endif
+} eb_name;
+
+// Fixed size record pool with heap fallback.
+typedef struct {
+  uint8_t *store;     // Static records storage.
+  uint16_t rec_size;  // The size of one record.
+  uint16_t size;      // The number of records in storage.
+  void *free;         // Free records list.
+  bool ready;         // Is free list built.
+  esp_eb_pool_info info;
+} eb_pool;
+
+// Wildcard (event name prefix) subscription.
+typedef struct {
+  char *prefix;  // The pattern without trailing '*'.
+  uint8_t len;   // The prefix length.
+  eb_node *head; // Subscribers in order of attaching.
+  bool dirty;    // Has subscribers detached during dispatch.
+} eb_wild;
+
+// The event name hash table.
+static eb_name *buckets[ESP_EB_BUCKETS];
+
+// The capacity of registered events table (built in and user events).
+#define ESP_EB_EVENTS_CAP (ESP_EB_ID_BUILTIN_CNT + ESP_EB_MAX_EVENTS)
+
+// Registered events indexed by event ID.
+static eb_name *events[ESP_EB_EVENTS_CAP];
+
+// The number of registered events.
+static esp_eb_id events_cnt;
+
+// Subscriber and scheduled delivery record pools.
+static eb_node pool_nodes_store[ESP_EB_POOL_NODES];
+static eb_event pool_events_store[ESP_EB_POOL_EVENTS];
+static eb_pool pools[] = {
+  {
+    .store = (uint8_t *) pool_nodes_store,
+    .rec_size = sizeof(eb_node),
+    .size = ESP_EB_POOL_NODES,
+  },
+  {
+    .store = (uint8_t *) pool_events_store,
+    .rec_size = sizeof(eb_event),
+    .size = ESP_EB_POOL_EVENTS,
+  },
+};
+
+// Subscriber handle table. Scheduled deliveries keep handles
+// instead of pointers so released subscribers are detected in O(1).
+// Starts with static storage and grows on the heap when needed.
+static eb_handle handles_store[ESP_EB_POOL_NODES];
+static eb_handle *handles = handles_store;
+static uint16_t handles_size = ESP_EB_POOL_NODES;
+static uint16_t handles_used;
+static uint16_t handles_free = ESP_EB_HANDLE_NONE;
+
+// Wildcard subscriptions. Each event keeps a bit mask of matching
+// slots so triggers never compare strings against patterns.
+static eb_wild *wilds[ESP_EB_MAX_WILDCARDS];
+
+// The trigger queue lanes used in queued dispatch mode.
+static eb_trigger queue_high[ESP_EB_QUEUE_SIZE_HIGH];
+static eb_trigger queue_normal[ESP_EB_QUEUE_SIZE];
+static eb_trigger queue_low[ESP_EB_QUEUE_SIZE_LOW];
+static eb_lane lanes[ESP_EB_PRIO_CNT] = {
+  {.items = queue_high, .size = ESP_EB_QUEUE_SIZE_HIGH},
+  {.items = queue_normal, .size = ESP_EB_QUEUE_SIZE},
+  {.items = queue_low, .size = ESP_EB_QUEUE_SIZE_LOW},
+};
+
+// The dispatcher task.
+static os_event_t task_queue[ESP_EB_TASK_QUEUE_LEN];
+static uint8_t task_prio;
+static bool task_posted;
+static bool task_ready;
+static bool queue_mode;
+
+#ifdef ESP_EB_TRACE_ON
+// Trace ring buffer.
+static eb_trace trace_ring[ESP_EB_TRACE_SIZE];
+static uint16_t trace_head; // The next entry to write.
+static uint32_t trace_cnt;  // The number of recorded entries.
+#endif
+
+// Timing wheel of scheduled deliveries. Every slot is FIFO list
+// of entries with deadline % ESP_EB_WHEEL_SLOTS equal to slot index.
+static eb_event *wheel_head[ESP_EB_WHEEL_SLOTS];
+static eb_event *wheel_tail[ESP_EB_WHEEL_SLOTS];
+static eb_event *wheel_due;   // Entries being delivered.
+static uint16_t wheel_cnt;    // The number of entries in slots.
+static uint32_t wheel_tick;   // The current tick.
+static uint32_t wheel_tick_us; // The time of the current tick.
+static os_timer_t wheel_timer;
+
+// WiFi event bridge indexed by SDK event.
+static const eb_wifi wifi_events[] = {
+  [EVENT_STAMODE_CONNECTED] = {ESP_EB_ID_STAMODE_CONNECTED, sizeof(Event_StaMode_Connected_t)},
+  [EVENT_STAMODE_DISCONNECTED] = {ESP_EB_ID_STAMODE_DISCONNECTED, sizeof(Event_StaMode_Disconnected_t)},
+  [EVENT_STAMODE_AUTHMODE_CHANGE] = {ESP_EB_ID_STAMODE_AUTHMODE_CHANGE, sizeof(Event_StaMode_AuthMode_Change_t)},
+  [EVENT_STAMODE_GOT_IP] = {ESP_EB_ID_STAMODE_GOT_IP, sizeof(Event_StaMode_Got_IP_t)},
+  [EVENT_STAMODE_DHCP_TIMEOUT] = {ESP_EB_ID_STAMODE_DHCP_TIMEOUT, 0},
+  [EVENT_SOFTAPMODE_STACONNECTED] = {ESP_EB_ID_SOFTAPMODE_STACONNECTED, sizeof(Event_SoftAPMode_StaConnected_t)},
+  [EVENT_SOFTAPMODE_STADISCONNECTED] = {ESP_EB_ID_SOFTAPMODE_STADISCONNECTED, sizeof(Event_SoftAPMode_StaDisconnected_t)},
+  [EVENT_SOFTAPMODE_PROBEREQRECVED] = {ESP_EB_ID_SOFTAPMODE_PROBEREQRECVED, sizeof(Event_SoftAPMode_ProbeReqRecved_t)},
+  [EVENT_OPMODE_CHANGED] = {ESP_EB_ID_OPMODE_CHANGED, sizeof(Event_OpMode_Change_t)},
+};
+
+// Interrupt trigger ring. Only esp_eb_trigger_from_isr
+// moves isr_head and only dispatcher task moves isr_tail.
+static eb_isr isr_ring[ESP_EB_ISR_QUEUE_SIZE];
+static volatile uint8_t isr_head;
+static volatile uint8_t isr_tail;
+static volatile bool isr_posted;
+static volatile uint32_t isr_dropped;
+
+// Dispatch nesting level. Subscribers detached
+// during dispatch are released when it drops to zero.
+static uint8_t dispatch_depth;
+static bool dispatch_dirty;
+
+#ifdef ESP_EB_STATS_ON
+// Global statistics.
+static uint32_t stats_latency[ESP_EB_LATENCY_BUCKETS];
+static uint16_t stats_queue_hwm;
+static uint16_t stats_pending;
+static uint16_t stats_pending_hwm;
+#endif
+
+// Built in events in ESP_EB_ID_* order.
+static eb_name builtin[ESP_EB_ID_BUILTIN_CNT] = {
+  {.name = ESP_EB_EVENT_STAMODE_CONNECTED, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_STAMODE_DISCONNECTED, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_STAMODE_AUTHMODE_CHANGE, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_STAMODE_GOT_IP, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_STAMODE_DHCP_TIMEOUT, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_SOFTAPMODE_STACONNECTED, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_SOFTAPMODE_STADISCONNECTED, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_OPMODE_CHANGED, .prio = ESP_EB_PRIO_HIGH},
+  {.name = ESP_EB_EVENT_SOFTAPMODE_PROBEREQRECVED, .prio = ESP_EB_PRIO_HIGH},
+};
+
+/**
+ * Calculate event name hash (FNV-1a).
+ *
+ * @param event_name The event name.
+ *
+ * @return The hash.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+name_hash(const char *event_name)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*event_name) {
+    hash ^= (uint8_t) *event_name++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/**
+ * Check if wildcard subscription matches event name.
+ *
+ * @param wild       The wildcard subscription.
+ * @param event_name The event name.
+ *
+ * @return true if matches, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+wild_match(const eb_wild *wild, const char *event_name)
+{
+  return strncmp(event_name, wild->prefix, wild->len) == 0;
+}
+
+/**
+ * Add event name to the hash table and assign it next event ID.
+ *
+ * @param name The event name entry.
+ * @param hash The event name hash.
+ */
+static void ICACHE_FLASH_ATTR
+add_name(eb_name *name, uint32_t hash)
+{
+  uint8_t slot;
+
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (wilds[slot] != NULL && wild_match(wilds[slot], name->name)) name->wild |= BIT(slot);
+  }
+
+  name->hash = hash;
+  name->id = events_cnt;
+  name->next = buckets[hash % ESP_EB_BUCKETS];
+  buckets[hash % ESP_EB_BUCKETS] = name;
+  events[events_cnt++] = name;
+}
+
+/**
+ * Register built in events.
+ *
+ * Called lazily by every function resolving event names or IDs.
+ */
+static void ICACHE_FLASH_ATTR
+init_events()
+{
+  uint8_t idx;
+
+  if (events_cnt > 0) return;
+  for (idx = 0; idx < ESP_EB_ID_BUILTIN_CNT; idx++) {
+    add_name(&builtin[idx], name_hash(builtin[idx].name));
+  }
+}
+
+/**
+ * Find event name in the hash table.
+ *
+ * @param event_name The event name.
+ * @param hash       The event name hash.
+ *
+ * @return The found name or NULL.
+ */
+static eb_name *ICACHE_FLASH_ATTR
+find_name(const char *event_name, uint32_t hash)
+{
+  eb_name *curr;
+
+  init_events();
+  curr = buckets[hash % ESP_EB_BUCKETS];
+  while (curr) {
+    if (curr->hash == hash && strcmp(curr->name, event_name) == 0) break;
+    curr = curr->next;
+  }
+
+  return curr;
+}
+
+/**
+ * Get registered event by ID.
+ *
+ * @param id The event ID.
+ *
+ * @return The event or NULL if ID was not registered.
+ */
+static eb_name *ICACHE_FLASH_ATTR
+get_name(esp_eb_id id)
+{
+  init_events();
+  if (id >= events_cnt) return NULL;
+
+  return events[id];
+}
+
+#ifdef ESP_EB_STATS_ON
+
+/**
+ * Count callback call and its latency.
+ *
+ * @param name     The event.
+ * @param ttime_us The trigger time.
+ */
+static void ICACHE_FLASH_ATTR
+stats_delivered(eb_name *name, uint32_t ttime_us)
+{
+  uint8_t bucket = 0;
+  uint32_t latency = system_get_time() - ttime_us;
+
+  while (latency > 1 && bucket < ESP_EB_LATENCY_BUCKETS - 1) {
+    latency >>= 1;
+    bucket++;
+  }
+
+  stats_latency[bucket]++;
+  name->stats.deliveries++;
+}
+
+/**
+ * Update queue depth high-water mark.
+ */
+static void ICACHE_FLASH_ATTR
+stats_queue_depth()
+{
+  uint8_t prio;
+  uint16_t depth = 0;
+
+  for (prio = 0; prio < ESP_EB_PRIO_CNT; prio++) depth += lanes[prio].len;
+  if (depth > stats_queue_hwm) stats_queue_hwm = depth;
+}
+
+  #define ESP_EB_STATS_INC(name, field) ((name)->stats.field++)
+  #define ESP_EB_STATS_DELIVERED(name, ttime_us) stats_delivered((name), (ttime_us))
+  #define ESP_EB_STATS_QUEUE_DEPTH() stats_queue_depth()
+#else
+  #define ESP_EB_STATS_INC(name, field) do {} while(0)
+  #define ESP_EB_STATS_DELIVERED(name, ttime_us) do {} while(0)
+  #define ESP_EB_STATS_QUEUE_DEPTH() do {} while(0)
+#endif
+
+#ifdef ESP_EB_TRACE_ON
+
+/**
+ * Record trace entry.
+ *
+ * @param phase The phase (ESP_EB_TRACE_*).
+ * @param id    The event ID.
+ * @param sub   The subscriber handle or ESP_EB_SUB_INVALID.
+ */
+static void ICACHE_FLASH_ATTR
+trace_add(uint8_t phase, esp_eb_id id, eb_sub sub)
+{
+  eb_trace *entry = &trace_ring[trace_head];
+
+  entry->ts_us = system_get_time();
+  entry->id = id;
+  entry->info = (uint16_t) ((phase << 14) | (sub & ESP_EB_TRACE_SUB_NONE));
+  trace_head = (uint16_t) ((trace_head + 1) % ESP_EB_TRACE_SIZE);
+  trace_cnt++;
+}
+
+  #define ESP_EB_TRACE(phase, id, sub) trace_add((phase), (id), (sub))
+#else
+  #define ESP_EB_TRACE(phase, id, sub) do {} while(0)
+#endif
+
+/**
+ * Check if event name is a wildcard pattern.
+ *
+ * @param event_name The event name.
+ *
+ * @return true if pattern, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+is_wild(const char *event_name)
+{
+  size_t len = strlen(event_name);
+
+  return len > 0 && event_name[len - 1] == '*';
+}
+
+/**
+ * Find wildcard subscription slot.
+ *
+ * @param pattern The pattern with trailing '*'.
+ *
+ * @return The slot or ESP_EB_WILD_NONE.
+ */
+static uint8_t ICACHE_FLASH_ATTR
+find_wild(const char *pattern)
+{
+  uint8_t slot;
+  size_t len = strlen(pattern) - 1;
+
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (wilds[slot] == NULL || wilds[slot]->len != len) continue;
+    if (strncmp(wilds[slot]->prefix, pattern, len) == 0) return slot;
+  }
+
+  return ESP_EB_WILD_NONE;
+}
+
+/**
+ * Create wildcard subscription and mark all matching events.
+ *
+ * @param pattern The pattern with trailing '*'.
+ *
+ * @return The slot or ESP_EB_WILD_NONE if out of memory or slots.
+ */
+static uint8_t ICACHE_FLASH_ATTR
+new_wild(const char *pattern)
+{
+  uint8_t slot;
+  esp_eb_id id;
+  eb_wild *wild;
+
+  init_events();
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) if (wilds[slot] == NULL) break;
+  if (slot == ESP_EB_MAX_WILDCARDS) return ESP_EB_WILD_NONE;
+
+  wild = os_zalloc(sizeof(eb_wild));
+  if (wild == NULL) return ESP_EB_WILD_NONE;
+
+  wild->prefix = esp_util_strdup(pattern);
+  if (wild->prefix == NULL) {
+    os_free(wild);
+    return ESP_EB_WILD_NONE;
+  }
+  wild->len = (uint8_t) (strlen(pattern) - 1);
+  wild->prefix[wild->len] = 0;
+  wilds[slot] = wild;
+
+  for (id = 0; id < events_cnt; id++) {
+    if (wild_match(wild, events[id]->name)) events[id]->wild |= BIT(slot);
+  }
+
+  return slot;
+}
+
+/**
+ * Release wildcard subscription without subscribers.
+ *
+ * @param slot The wildcard subscription slot.
+ */
+static void ICACHE_FLASH_ATTR
+free_wild(uint8_t slot)
+{
+  esp_eb_id id;
+
+  for (id = 0; id < events_cnt; id++) events[id]->wild &= ~BIT(slot);
+  os_free(wilds[slot]->prefix);
+  os_free(wilds[slot]);
+  wilds[slot] = NULL;
+}
+
+/**
+ * Initialize trigger payload.
+ *
+ * @param msg  The payload to initialize.
+ * @param arg  The trigger argument.
+ * @param size The number of bytes to copy from arg (0 - pass arg as is).
+ *
+ * @return true on success, false when out of memory.
+ */
+static bool ICACHE_FLASH_ATTR
+msg_init(eb_msg *msg, const void *arg, uint16_t size)
+{
+  msg->arg = (void *) arg;
+  msg->buf = NULL;
+#ifdef ESP_EB_STATS_ON
+  msg->ttime_us = system_get_time();
+#endif
+  if (size == 0 || arg == NULL) return true;
+
+  msg->buf = os_malloc(sizeof(eb_buf) + size);
+  if (msg->buf == NULL) return false;
+
+  msg->buf->refs = 1;
+  msg->buf->size = size;
+  memcpy(msg->buf->data, arg, size);
+  msg->arg = msg->buf->data;
+
+  return true;
+}
+
+/**
+ * Take reference to the payload copy.
+ *
+ * @param msg The payload.
+ */
+static void ICACHE_FLASH_ATTR
+msg_retain(eb_msg *msg)
+{
+  if (msg->buf != NULL) msg->buf->refs++;
+}
+
+/**
+ * Drop reference to the payload copy.
+ *
+ * The copy is released when last reference is dropped.
+ *
+ * @param msg The payload.
+ */
+static void ICACHE_FLASH_ATTR
+msg_release(eb_msg *msg)
+{
+  if (msg->buf == NULL) return;
+  if (--msg->buf->refs == 0) os_free(msg->buf);
+  msg->buf = NULL;
+}
+
+/**
+ * Take zeroed record from the pool.
+ *
+ * Allocates record on the heap when pool is exhausted.
+ *
+ * @param pool The pool.
+ *
+ * @return The record or NULL when out of memory.
+ */
+static void *ICACHE_FLASH_ATTR
+pool_alloc(eb_pool *pool)
+{
+  uint16_t idx;
+  void *rec;
+
+  if (!pool->ready) {
+    for (idx = 0; idx < pool->size; idx++) {
+      rec = pool->store + idx * pool->rec_size;
+      *(void **) rec = pool->free;
+      pool->free = rec;
+    }
+    pool->info.size = pool->size;
+    pool->ready = true;
+  }
+
+  if (pool->free == NULL) {
+    rec = os_zalloc(pool->rec_size);
+    if (rec != NULL) pool->info.heap++;
+    return rec;
+  }
+
+  rec = pool->free;
+  pool->free = *(void **) rec;
+  memset(rec, 0, pool->rec_size);
+
+  pool->info.used++;
+  if (pool->info.used > pool->info.hwm) pool->info.hwm = pool->info.used;
+
+  return rec;
+}
+
+/**
+ * Return record to the pool.
+ *
+ * @param pool The pool.
+ * @param rec  The record.
+ */
+static void ICACHE_FLASH_ATTR
+pool_free(eb_pool *pool, void *rec)
+{
+  uint8_t *ptr = rec;
+
+  if (ptr < pool->store || ptr >= pool->store + pool->size * pool->rec_size) {
+    pool->info.heap--;
+    os_free(rec);
+    return;
+  }
+
+  *(void **) rec = pool->free;
+  pool->free = rec;
+  pool->info.used--;
+}
+
+/**
+ * Take subscriber handle.
+ *
+ * @param node The subscriber.
+ *
+ * @return true on success, false when out of memory.
+ */
+static bool ICACHE_FLASH_ATTR
+handle_new(eb_node *node)
+{
+  uint16_t idx;
+  eb_handle *grown;
+
+  if (handles_free == ESP_EB_HANDLE_NONE) {
+    if (handles_used == handles_size) {
+      if (handles_size >= ESP_EB_HANDLE_NONE / 2) return false;
+
+      grown = os_zalloc(2 * handles_size * sizeof(eb_handle));
+      if (grown == NULL) return false;
+
+      memcpy(grown, handles, handles_size * sizeof(eb_handle));
+      if (handles != handles_store) os_free(handles);
+      handles = grown;
+      handles_size *= 2;
+    }
+    idx = handles_used++;
+  } else {
+    idx = handles_free;
+    handles_free = handles[idx].next;
+  }
+
+  handles[idx].node = node;
+  node->sub = ((uint32_t) handles[idx].gen << 16) | idx;
+
+  return true;
+}
+
+/**
+ * Release subscriber handle.
+ *
+ * All copies of the handle become invalid.
+ *
+ * @param node The subscriber.
+ */
+static void ICACHE_FLASH_ATTR
+handle_free(eb_node *node)
+{
+  uint16_t idx = (uint16_t) (node->sub & 0xFFFF);
+
+  handles[idx].node = NULL;
+  handles[idx].gen++;
+  handles[idx].next = handles_free;
+  handles_free = idx;
+}
+
+/**
+ * Get subscriber by handle.
+ *
+ * @param sub The subscriber handle.
+ *
+ * @return The subscriber or NULL if it was released.
+ */
+static eb_node *ICACHE_FLASH_ATTR
+handle_get(eb_sub sub)
+{
+  uint16_t idx = (uint16_t) (sub & 0xFFFF);
+
+  if (idx >= handles_used || handles[idx].gen != (uint16_t) (sub >> 16)) return NULL;
+
+  return handles[idx].node;
+}
+
+/**
+ * Create new event delivery structure.
+ *
+ * @param id   The event ID.
+ * @param sub  The subscriber handle.
+ * @param msg  The payload. Takes reference to the payload copy.
+ */
+static eb_event *ICACHE_FLASH_ATTR
+event_new(esp_eb_id id, eb_sub sub, const eb_msg *msg)
+{
+  eb_event *new = pool_alloc(&pools[ESP_EB_POOL_EVENT]);
+  if (new == NULL) return NULL;
+
+  new->id = id;
+  new->sub = sub;
+  new->msg = *msg;
+  msg_retain(&new->msg);
+
+#ifdef ESP_EB_STATS_ON
+  stats_pending++;
+  if (stats_pending > stats_pending_hwm) stats_pending_hwm = stats_pending;
+#endif
+
+  return new;
+}
+
+/**
+ * Release memory allocated for en event structure.
+ *
+ * @param event The event structure.
+ */
+static void ICACHE_FLASH_ATTR
+free_event(eb_event *event)
+{
+  msg_release(&event->msg);
+#ifdef ESP_EB_STATS_ON
+  stats_pending--;
+#endif
+  pool_free(&pools[ESP_EB_POOL_EVENT], event);
+}
+
+/**
+ * Create new subscriber node.
+ *
+ * @param cb          The callback.
+ * @param throttle_us Throttle callback calls (0 - no throttle).
+ */
+static eb_node *ICACHE_FLASH_ATTR
+new_node(esp_eb_cb *cb, uint32_t throttle_us)
+{
+  eb_node *new_node = pool_alloc(&pools[ESP_EB_POOL_NODE]);
+  if (new_node == NULL) return NULL;
+
+  if (!handle_new(new_node)) {
+    pool_free(&pools[ESP_EB_POOL_NODE], new_node);
+    return NULL;
+  }
+
+  new_node->cb = cb;
+  new_node->throttle_us = throttle_us;
+
+  return new_node;
+}
+
+/**
+ * Release memory allocated for node list.
+ *
+ * @param node The node.
+ */
+static void ICACHE_FLASH_ATTR
+free_node(eb_node *node)
+{
+  if (node->pending != NULL) {
+    os_timer_disarm(&node->pending->timer);
+    msg_release(&node->pending->msg);
+    os_free(node->pending);
+  }
+  handle_free(node);
+  pool_free(&pools[ESP_EB_POOL_NODE], node);
+}
+
+/**
+ * Find subscriber node on the subscriber list.
+ *
+ * Cases:
+ *                ret,  prev
+ *  - empty list: NULL, NULL
+ *  - head:       head, NULL
+ *  - not found:  NULL, tail
+ *  - found:      node, prev
+ *
+ * @param head The subscriber list head.
+ * @param cb   The event callback.
+ * @param prev The previous node to the found one.
+ *
+ * @return The found node or NULL
+ */
+static eb_node *ICACHE_FLASH_ATTR
+find_node(eb_node *head, esp_eb_cb *cb, eb_node **prev)
+{
+  eb_node *curr = head;
+  if (prev != NULL) *prev = NULL;
+
+  while (curr) {
+    if (curr->cb == cb) break;
+    if (prev != NULL) *prev = curr;
+    curr = curr->next;
+  }
+
+  return curr;
+}
+
+/**
+ * Release subscribers marked as detached.
+ *
+ * @param head The subscriber list head.
+ */
+static void ICACHE_FLASH_ATTR
+sweep_list(eb_node **head)
+{
+  eb_node **link = head;
+  eb_node *curr;
+
+  while ((curr = *link) != NULL) {
+    if (curr->cb == NULL) {
+      *link = curr->next;
+      free_node(curr);
+    } else {
+      link = &curr->next;
+    }
+  }
+}
+
+/**
+ * Release subscribers detached during dispatch.
+ */
+static void ICACHE_FLASH_ATTR
+sweep_nodes()
+{
+  esp_eb_id id;
+  uint8_t slot;
+
+  for (id = 0; id < events_cnt; id++) {
+    if (!events[id]->dirty) continue;
+    sweep_list(&events[id]->head);
+    events[id]->dirty = false;
+  }
+
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (wilds[slot] == NULL || !wilds[slot]->dirty) continue;
+    sweep_list(&wilds[slot]->head);
+    wilds[slot]->dirty = false;
+    if (wilds[slot]->head == NULL) free_wild(slot);
+  }
+
+  dispatch_dirty = false;
+}
+
+/**
+ * Remove subscriber from the list.
+ *
+ * During dispatch the subscriber is only marked as detached.
+ *
+ * @param head  The subscriber list head.
+ * @param dirty Set when subscriber is only marked as detached.
+ * @param cb    The event callback.
+ *
+ * @return true if subscriber was found, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+remove_node(eb_node **head, bool *dirty, esp_eb_cb *cb)
+{
+  eb_node *prev;
+  eb_node *curr = find_node(*head, cb, &prev);
+
+  // Not found.
+  if (curr == NULL) return false;
+
+  if (dispatch_depth > 0) {
+    // Somebody may be iterating over the list.
+    if (curr->pending != NULL) {
+      os_timer_disarm(&curr->pending->timer);
+      msg_release(&curr->pending->msg);
+    }
+    curr->cb = NULL;
+    *dirty = true;
+    dispatch_dirty = true;
+  } else {
+    if (prev != NULL) prev->next = curr->next;
+    if (curr == *head) *head = curr->next;
+    free_node(curr);
+  }
+
+  return true;
+}
+
+/**
+ * Mark the beginning of callback dispatch.
+ *
+ * Until matching dispatch_end() call no subscriber node is released.
+ */
+static void ICACHE_FLASH_ATTR
+dispatch_begin()
+{
+  dispatch_depth++;
+}
+
+/**
+ * Mark the end of callback dispatch.
+ */
+static void ICACHE_FLASH_ATTR
+dispatch_end()
+{
+  dispatch_depth--;
+  if (dispatch_depth == 0 && dispatch_dirty) sweep_nodes();
+}
+
+esp_eb_id ICACHE_FLASH_ATTR
+esp_eb_register(const char *event_name)
+{
+  uint32_t hash = name_hash(event_name);
+  eb_name *name = find_name(event_name, hash);
+  if (name != NULL) return name->id;
+
+  if (events_cnt >= ESP_EB_EVENTS_CAP) {
+    ESP_EB_ERROR("no room to register %s\n", event_name);
+    return ESP_EB_ID_INVALID;
+  }
+
+  name = os_zalloc(sizeof(eb_name));
+  if (name == NULL) return ESP_EB_ID_INVALID;
+
+  name->name = esp_util_strdup(event_name);
+  if (name->name == NULL) {
+    os_free(name);
+    return ESP_EB_ID_INVALID;
+  }
+  name->prio = ESP_EB_PRIO_NORMAL;
+  add_name(name, hash);
+
+  ESP_EB_DEBUG("registered %s as %d\n", event_name, name->id);
+  return name->id;
+}
+
+esp_eb_id ICACHE_FLASH_ATTR
+esp_eb_lookup(const char *event_name)
+{
+  eb_name *name = find_name(event_name, name_hash(event_name));
+  if (name == NULL) return ESP_EB_ID_INVALID;
+
+  return name->id;
+}
+
+const char *ICACHE_FLASH_ATTR
+esp_eb_name(esp_eb_id id)
+{
+  eb_name *name = get_name(id);
+  if (name == NULL) return NULL;
+
+  return name->name;
+}
+
+/**
+ * Add subscriber to the list.
+ *
+ * @param head        The subscriber list head.
+ * @param id          The event ID (ESP_EB_ID_INVALID for wildcards).
+ * @param cb          The event callback.
+ * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param window_us   Debounce / coalesce window (0 - deliver every trigger).
+ * @param debounce    Restart the window on every trigger.
+ *
+ * @return The result of adding new subscriber.
+ */
+static esp_eb_err ICACHE_FLASH_ATTR
+add_node(eb_node **head, esp_eb_id id, esp_eb_cb *cb,
+         uint32_t throttle_us, uint32_t window_us, bool debounce)
+{
+  eb_node *tail = NULL;
+  eb_node *node = find_node(*head, cb, &tail);
+
+  // If node already exists we return.
+  if (node != NULL) return ESP_EB_ATTACH_EXISTED;
+
+  node = new_node(cb, throttle_us);
+  if (node == NULL) return ESP_EB_ATTACH_MEM;
+
+  if (window_us > 0) {
+    node->pending = os_zalloc(sizeof(eb_pending));
+    if (node->pending == NULL) {
+      free_node(node);
+      return ESP_EB_ATTACH_MEM;
+    }
+    node->pending->id = id;
+    node->pending->window_ms = (window_us + 999) / 1000;
+    node->pending->debounce = debounce;
+  }
+
+  if (tail == NULL) {
+    *head = node;
+  } else {
+    tail->next = node;
+  }
+
+  return ESP_EB_ATTACH_OK;
+}
+
+/**
+ * Add subscriber to registered event.
+ *
+ * @param id          The event ID.
+ * @param cb          The event callback.
+ * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param window_us   Debounce / coalesce window (0 - deliver every trigger).
+ * @param debounce    Restart the window on every trigger.
+ *
+ * @return The result of adding new subscriber.
+ */
+static esp_eb_err ICACHE_FLASH_ATTR
+attach(esp_eb_id id, esp_eb_cb *cb, uint32_t throttle_us, uint32_t window_us, bool debounce)
+{
+  eb_name *name = get_name(id);
+  if (name == NULL) return ESP_EB_ATTACH_ID;
+
+  esp_eb_err err = add_node(&name->head, id, cb, throttle_us, window_us, debounce);
+  if (err == ESP_EB_ATTACH_OK) ESP_EB_DEBUG("added %s %d %p\n", name->name, throttle_us, cb);
+
+  return err;
+}
+
+/**
+ * Add wildcard subscriber.
+ *
+ * @param pattern     The pattern with trailing '*'.
+ * @param cb          The event callback.
+ * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param window_us   Debounce / coalesce window (0 - deliver every trigger).
+ * @param debounce    Restart the window on every trigger.
+ *
+ * @return The result of adding new subscriber.
+ */
+static esp_eb_err ICACHE_FLASH_ATTR
+attach_wild(const char *pattern, esp_eb_cb *cb, uint32_t throttle_us, uint32_t window_us, bool debounce)
+{
+  uint8_t slot;
+
+  if (strlen(pattern) - 1 > ESP_EB_WILD_LEN_MAX) {
+    ESP_EB_ERROR("wildcard pattern too long %s\n", pattern);
+    return ESP_EB_ATTACH_NAME;
+  }
+
+  slot = find_wild(pattern);
+  if (slot == ESP_EB_WILD_NONE) {
+    slot = new_wild(pattern);
+    if (slot == ESP_EB_WILD_NONE) return ESP_EB_ATTACH_FULL;
+  }
+
+  esp_eb_err err = add_node(&wilds[slot]->head, ESP_EB_ID_INVALID, cb, throttle_us, window_us, debounce);
+  if (wilds[slot]->head == NULL) free_wild(slot);
+  if (err == ESP_EB_ATTACH_OK) ESP_EB_DEBUG("added %s %d %p\n", pattern, throttle_us, cb);
+
+  return err;
+}
+
+/**
+ * Add subscriber to event or wildcard pattern.
+ *
+ * @param event_name  The event name or pattern with trailing '*'.
+ * @param cb          The event callback.
+ * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param window_us   Debounce / coalesce window (0 - deliver every trigger).
+ * @param debounce    Restart the window on every trigger.
+ *
+ * @return The result of adding new subscriber.
+ */
+static esp_eb_err ICACHE_FLASH_ATTR
+attach_name(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us, uint32_t window_us, bool debounce)
+{
+  if (is_wild(event_name)) return attach_wild(event_name, cb, throttle_us, window_us, debounce);
+
+  esp_eb_id id = esp_eb_register(event_name);
+  if (id == ESP_EB_ID_INVALID) {
+    return events_cnt >= ESP_EB_EVENTS_CAP ? ESP_EB_ATTACH_FULL : ESP_EB_ATTACH_MEM;
+  }
+
+  return attach(id, cb, throttle_us, window_us, debounce);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_throttled_id(esp_eb_id id, esp_eb_cb *cb, uint32_t throttle_us)
+{
+  return attach(id, cb, throttle_us, 0, false);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_coalesced_id(esp_eb_id id, esp_eb_cb *cb, uint32_t window_us)
+{
+  return attach(id, cb, 0, window_us, false);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_debounced_id(esp_eb_id id, esp_eb_cb *cb, uint32_t window_us)
+{
+  return attach(id, cb, 0, window_us, true);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_id(esp_eb_id id, esp_eb_cb *cb)
+{
+  return esp_eb_attach_throttled_id(id, cb, 0);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_throttled(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us)
+{
+  return attach_name(event_name, cb, throttle_us, 0, false);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_coalesced(const char *event, esp_eb_cb *cb, uint32_t window_us)
+{
+  return attach_name(event, cb, 0, window_us, false);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_debounced(const char *event, esp_eb_cb *cb, uint32_t window_us)
+{
+  return attach_name(event, cb, 0, window_us, true);
+}
+
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach(const char *event, esp_eb_cb *cb)
+{
+  return esp_eb_attach_throttled(event, cb, 0);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_eb_detach_id(esp_eb_id id, esp_eb_cb *cb)
+{
+  eb_name *name = get_name(id);
+  if (name == NULL) return true;
+
+  if (remove_node(&name->head, &name->dirty, cb)) {
+    ESP_EB_DEBUG("detached node %s %p\n", name->name, cb);
+  }
+
+  return true;
+}
+
+/**
+ * Stop wildcard subscription.
+ *
+ * @param slot The wildcard subscription slot.
+ * @param cb   The event callback.
+ *
+ * @return true if subscriber was found, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+detach_wild(uint8_t slot, esp_eb_cb *cb)
+{
+  eb_wild *wild = wilds[slot];
+
+  if (!remove_node(&wild->head, &wild->dirty, cb)) return false;
+
+  ESP_EB_DEBUG("detached node %s* %p\n", wild->prefix, cb);
+  if (wild->head == NULL) free_wild(slot);
+
+  return true;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_eb_detach(const char *event_name, esp_eb_cb *cb)
+{
+  uint8_t slot;
+
+  if (is_wild(event_name)) {
+    slot = find_wild(event_name);
+    if (slot != ESP_EB_WILD_NONE) detach_wild(slot, cb);
+    return true;
+  }
+
+  return esp_eb_detach_id(esp_eb_lookup(event_name), cb);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_eb_remove_cb(esp_eb_cb *cb)
+{
+  esp_eb_id id;
+  uint8_t slot;
+
+  // Callback is attached at most once to every event and pattern.
+  init_events();
+  for (id = 0; id < events_cnt; id++) esp_eb_detach_id(id, cb);
+
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (wilds[slot] != NULL) detach_wild(slot, cb);
+  }
+
+  return true;
+}
+
+/**
+ * Deliver the newest payload at the end of debounce / coalesce window.
+ *
+ * @param arg The subscriber node.
+ */
+static void ICACHE_FLASH_ATTR
+pending_cb(void *arg)
+{
+  eb_node *node = arg;
+  eb_pending *pending = node->pending;
+  eb_msg msg = pending->msg;
+
+  // Callback may detach the subscriber so we take over the payload.
+  pending->msg.buf = NULL;
+  pending->armed = false;
+  node->ctime_us = system_get_time();
+
+  ESP_EB_STATS_DELIVERED(events[pending->id], msg.ttime_us);
+  ESP_EB_TRACE(ESP_EB_TRACE_DISPATCHED, pending->id, node->sub);
+  dispatch_begin();
+  node->cb(events[pending->id]->name, msg.arg);
+  dispatch_end();
+  msg_release(&msg);
+}
+
+/**
+ * Store payload of debounced or coalesced subscriber
+ * and arm its timer if needed.
+ *
+ * @param name The event.
+ * @param node The subscriber.
+ * @param msg  The payload.
+ */
+static void ICACHE_FLASH_ATTR
+defer(const eb_name *name, eb_node *node, const eb_msg *msg)
+{
+  eb_pending *pending = node->pending;
+
+  // Wildcard subscribers get the newest event.
+  pending->id = name->id;
+  msg_release(&pending->msg);
+  pending->msg = *msg;
+  msg_retain(&pending->msg);
+  if (pending->armed && !pending->debounce) return;
+
+  os_timer_disarm(&pending->timer);
+  os_timer_setfn(&pending->timer, pending_cb, node);
+  os_timer_arm(&pending->timer, pending->window_ms, false);
+  pending->armed = true;
+}
+
+/**
+ * Call subscriber callback unless it's throttled.
+ *
+ * @param name The event.
+ * @param node The subscriber.
+ * @param msg  The payload.
+ */
+static void ICACHE_FLASH_ATTR
+deliver(eb_name *name, eb_node *node, const eb_msg *msg)
+{
+  uint32_t now = system_get_time();
+
+  // Detached during dispatch.
+  if (node->cb == NULL) return;
+  if (node->pending != NULL) {
+    defer(name, node, msg);
+    return;
+  }
+  if (node->throttle_us > 0 && now - node->ctime_us < node->throttle_us) {
+    ESP_EB_STATS_INC(name, throttled);
+    ESP_EB_TRACE(ESP_EB_TRACE_THROTTLED, name->id, node->sub);
+    return;
+  }
+
+  node->ctime_us = now;
+  ESP_EB_STATS_DELIVERED(name, msg->ttime_us);
+  ESP_EB_TRACE(ESP_EB_TRACE_DISPATCHED, name->id, node->sub);
+  node->cb(name->name, msg->arg);
+}
+
+/**
+ * Deliver scheduled entry if its subscriber still exists.
+ *
+ * @param event The wheel entry.
+ */
+static void ICACHE_FLASH_ATTR
+wheel_deliver(eb_event *event)
+{
+  // Subscriber may be detached by now.
+  eb_node *node = handle_get(event->sub);
+  if (node != NULL) deliver(events[event->id], node, &event->msg);
+}
+
+/**
+ * Timing wheel tick.
+ *
+ * Moves due entries of the current slot to the due list ordered by
+ * event priority (FIFO within the same priority) and delivers them.
+ * The tick is disarmed when wheel is empty.
+ *
+ * @param arg Unused.
+ */
+static void ICACHE_FLASH_ATTR
+wheel_cb(void *arg)
+{
+  eb_event *curr, *prev = NULL, *next;
+  eb_event *due_head[ESP_EB_PRIO_CNT] = {NULL}, *due_tail[ESP_EB_PRIO_CNT] = {NULL};
+  eb_event **link = &wheel_due;
+  uint8_t slot, prio;
+
+  wheel_tick++;
+  wheel_tick_us = system_get_time();
+  slot = (uint8_t) (wheel_tick % ESP_EB_WHEEL_SLOTS);
+
+  for (curr = wheel_head[slot]; curr != NULL; curr = next) {
+    next = curr->next;
+    if (curr->deadline != wheel_tick) {
+      prev = curr;
+      continue;
+    }
+
+    if (prev == NULL) wheel_head[slot] = next;
+    else prev->next = next;
+    if (wheel_tail[slot] == curr) wheel_tail[slot] = prev;
+
+    curr->next = NULL;
+    prio = events[curr->id]->prio;
+    if (due_tail[prio] == NULL) due_head[prio] = curr;
+    else due_tail[prio]->next = curr;
+    due_tail[prio] = curr;
+    wheel_cnt--;
+  }
+
+  for (prio = 0; prio < ESP_EB_PRIO_CNT; prio++) {
+    if (due_head[prio] == NULL) continue;
+    *link = due_head[prio];
+    link = &due_tail[prio]->next;
+  }
+
+  dispatch_begin();
+  while (wheel_due != NULL) {
+    curr = wheel_due;
+    wheel_due = curr->next;
+    if (curr->sub != ESP_EB_SUB_INVALID) wheel_deliver(curr);
+    free_event(curr);
+  }
+  dispatch_end();
+
+  if (wheel_cnt == 0) os_timer_disarm(&wheel_timer);
+}
+
+/**
+ * Compute timing wheel deadline and start the tick if needed.
+ *
+ * The deadline is the first tick not earlier than delay,
+ * with zero delay the next tick.
+ *
+ * @param delay The delay in milliseconds.
+ *
+ * @return The wheel tick to deliver at.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+wheel_deadline(uint32_t delay)
+{
+  uint32_t ticks, elapsed_us = 0;
+
+  if (wheel_cnt == 0) {
+    wheel_tick_us = system_get_time();
+    os_timer_disarm(&wheel_timer);
+    os_timer_setfn(&wheel_timer, wheel_cb, NULL);
+    os_timer_arm(&wheel_timer, ESP_EB_WHEEL_TICK_MS, true);
+  } else {
+    elapsed_us = system_get_time() - wheel_tick_us;
+  }
+
+  // Round up only once, the delay counts from now not from the last tick.
+  ticks = (uint32_t) ((elapsed_us + delay * 1000ULL + ESP_EB_WHEEL_TICK_MS * 1000 - 1) / (ESP_EB_WHEEL_TICK_MS * 1000));
+  if (delay == 0 || ticks == 0) ticks = 1;
+
+  return wheel_tick + ticks;
+}
+
+/**
+ * Append batch of entries to their timing wheel slot.
+ *
+ * @param batch The entries.
+ */
+static void ICACHE_FLASH_ATTR
+wheel_add(const eb_batch *batch)
+{
+  uint8_t slot;
+
+  if (batch->cnt == 0) {
+    // Nothing was scheduled, do not leave the tick running.
+    if (wheel_cnt == 0) os_timer_disarm(&wheel_timer);
+    return;
+  }
+
+  slot = (uint8_t) (batch->deadline % ESP_EB_WHEEL_SLOTS);
+  if (wheel_tail[slot] == NULL) wheel_head[slot] = batch->head;
+  else wheel_tail[slot]->next = batch->head;
+  wheel_tail[slot] = batch->tail;
+  wheel_cnt += batch->cnt;
+}
+
+/**
+ * Drop scheduled deliveries of the event.
+ *
+ * @param id The event ID.
+ *
+ * @return The number of dropped deliveries.
+ */
+static uint16_t ICACHE_FLASH_ATTR
+wheel_cancel(esp_eb_id id)
+{
+  eb_event *curr, *prev, *next;
+  uint16_t slot, cnt = 0;
+
+  for (slot = 0; slot < ESP_EB_WHEEL_SLOTS && wheel_cnt > 0; slot++) {
+    prev = NULL;
+    for (curr = wheel_head[slot]; curr != NULL; curr = next) {
+      next = curr->next;
+      if (curr->id != id) {
+        prev = curr;
+        continue;
+      }
+
+      if (prev == NULL) wheel_head[slot] = next;
+      else prev->next = next;
+      if (wheel_tail[slot] == curr) wheel_tail[slot] = prev;
+
+      free_event(curr);
+      wheel_cnt--;
+      cnt++;
+    }
+  }
+
+  // Entries of the current tick are released by wheel_cb.
+  for (curr = wheel_due; curr != NULL; curr = curr->next) {
+    if (curr->id != id || curr->sub == ESP_EB_SUB_INVALID) continue;
+    curr->sub = ESP_EB_SUB_INVALID;
+    cnt++;
+  }
+
+  if (wheel_cnt == 0) os_timer_disarm(&wheel_timer);
+
+  return cnt;
+}
+
+/**
+ * Schedule delivery to the subscriber.
+ *
+ * @param name  The event.
+ * @param node  The subscriber.
+ * @param msg   The payload.
+ * @param batch The entries to append new entry to.
+ */
+static void ICACHE_FLASH_ATTR
+schedule_node(eb_name *name, const eb_node *node, const eb_msg *msg, eb_batch *batch)
+{
+  // By the time entry is delivered it is possible node will
+  // no longer exist so we keep its handle.
+  eb_event *event = event_new(name->id, node->sub, msg);
+  if (event == NULL) {
+    ESP_EB_STATS_INC(name, mem_errors);
+    ESP_EB_TRACE(ESP_EB_TRACE_DROPPED, name->id, node->sub);
+    ESP_EB_ERROR("error scheduling %s\n", name->name);
+    return;
+  }
+
+  event->deadline = batch->deadline;
+  event->next = NULL;
+  if (batch->tail == NULL) batch->head = event;
+  else batch->tail->next = event;
+  batch->tail = event;
+  batch->cnt++;
+}
+
+/**
+ * Schedule delivery to every event subscriber.
+ *
+ * @param name  The event.
+ * @param msg   The payload.
+ * @param batch The entries to append new entries to.
+ */
+static void ICACHE_FLASH_ATTR
+schedule_subs(eb_name *name, const eb_msg *msg, eb_batch *batch)
+{
+  uint8_t slot;
+  eb_node *curr;
+
+  for (curr = name->head; curr != NULL; curr = curr->next) {
+    schedule_node(name, curr, msg, batch);
+  }
+
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (!(name->wild & BIT(slot))) continue;
+    for (curr = wilds[slot]->head; curr != NULL; curr = curr->next) {
+      schedule_node(name, curr, msg, batch);
+    }
+  }
+}
+
+/**
+ * Schedule delivery to every event subscriber on the timing wheel.
+ *
+ * @param name  The event.
+ * @param msg   The payload.
+ * @param delay The delay in milliseconds.
+ */
+static void ICACHE_FLASH_ATTR
+schedule(eb_name *name, const eb_msg *msg, uint32_t delay)
+{
+  eb_batch batch = {0};
+
+  ESP_EB_DEBUG("scheduling %s in %d ms\n", name->name, delay);
+
+  batch.deadline = wheel_deadline(delay);
+  schedule_subs(name, msg, &batch);
+  wheel_add(&batch);
+}
 
-// Linked list of attached events.
-typedef struct node {
-  eb_event *event;   // The event.
-  struct node *next; // The pointer to the next node on the list.
-} eb_node;
+/**
+ * Notify all event subscribers right away.
+ *
+ * @param name The event.
+ * @param msg  The payload.
+ */
+static void ICACHE_FLASH_ATTR
+dispatch(eb_name *name, const eb_msg *msg)
+{
+  uint8_t slot;
+  eb_node *curr;
+
+  dispatch_begin();
+  for (curr = name->head; curr != NULL; curr = curr->next) deliver(name, curr, msg);
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (!(name->wild & BIT(slot))) continue;
+    for (curr = wilds[slot]->head; curr != NULL; curr = curr->next) deliver(name, curr, msg);
+  }
+  dispatch_end();
+}
 
-// The linked list head node.
-static eb_node *head;
+/**
+ * Post dispatcher task message unless one is already pending.
+ */
+static void ICACHE_FLASH_ATTR
+task_post()
+{
+  if (task_posted) return;
+  task_posted = system_os_post(task_prio, ESP_EB_SIG_QUEUE, 0);
+}
 
 /**
- * Create new event structure.
+ * Take the oldest trigger from the highest priority non empty lane.
  *
- * @param event_name  The event name.
- * @param cb          The callback.
- * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param trigger The trigger to set.
+ *
+ * @return true on success, false if all lanes are empty.
  */
-static eb_event *ICACHE_FLASH_ATTR
-event_new(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us)
+static bool ICACHE_FLASH_ATTR
+queue_pop(eb_trigger *trigger)
 {
-  eb_event *new = os_zalloc(sizeof(eb_event));
-  if (new == NULL) return NULL;
+  uint8_t prio;
+  eb_lane *lane;
 
-  new->name = esp_util_strdup(event_name);
-  new->cb = cb;
-  new->throttle_us = throttle_us;
+  for (prio = 0; prio < ESP_EB_PRIO_CNT; prio++) {
+    lane = &lanes[prio];
+    if (lane->len == 0) continue;
 
-  return new;
+    *trigger = lane->items[lane->head];
+    lane->head = (uint16_t) ((lane->head + 1) % lane->size);
+    lane->len--;
+
+    return true;
+  }
+
+  return false;
 }
 
 /**
- * Release memory allocated for en event structure.
+ * Take the oldest trigger from the interrupt ring.
  *
- * @param event The event structure.
+ * @param trigger The trigger to set.
+ *
+ * @return true on success, false if ring is empty.
+ */
+static bool ICACHE_FLASH_ATTR
+isr_pop(eb_trigger *trigger)
+{
+  uint8_t tail = isr_tail;
+  if (tail == isr_head) return false;
+
+  eb_isr *rec = &isr_ring[tail % ESP_EB_ISR_QUEUE_SIZE];
+  trigger->id = rec->id;
+  trigger->msg.arg = (void *) (size_t) rec->value;
+  trigger->msg.buf = NULL;
+#ifdef ESP_EB_STATS_ON
+  trigger->msg.ttime_us = rec->ttime_us;
+#endif
+  // Release the record after it was read.
+  isr_tail = (uint8_t) (tail + 1);
+
+  ESP_EB_STATS_INC(events[trigger->id], triggers);
+  ESP_EB_TRACE(ESP_EB_TRACE_TRIGGERED, trigger->id, ESP_EB_SUB_INVALID);
+
+  return true;
+}
+
+/**
+ * The dispatcher task.
+ *
+ * Dispatches at most ESP_EB_TASK_BATCH triggers (interrupt ring first)
+ * and posts itself again if there is more.
+ *
+ * @param e The task event.
  */
 static void ICACHE_FLASH_ATTR
-free_event(eb_event *event)
+task_cb(os_event_t *e)
 {
-  os_free(event->name);
-  os_free(event);
+  uint16_t cnt;
+  eb_trigger trigger;
+
+  if (e->sig == ESP_EB_SIG_ISR) isr_posted = false;
+  else task_posted = false;
+
+  for (cnt = 0; cnt < ESP_EB_TASK_BATCH && isr_pop(&trigger); cnt++) {
+    dispatch(events[trigger.id], &trigger.msg);
+  }
+  for (; cnt < ESP_EB_TASK_BATCH && queue_pop(&trigger); cnt++) {
+    dispatch(events[trigger.id], &trigger.msg);
+    msg_release(&trigger.msg);
+  }
+
+  if (cnt == ESP_EB_TASK_BATCH) task_post();
 }
 
 /**
- * Create new event list node.
+ * Add trigger to the dispatcher queue lane of the event
+ * without waking up the dispatcher task.
  *
- * @param event_name  The event name.
- * @param cb          The callback.
- * @param throttle_us Throttle callback calls (0 - no throttle).
+ * @param name The event.
+ * @param msg  The payload.
+ *
+ * @return true on success, false if queue is full.
  */
-static eb_node *ICACHE_FLASH_ATTR
-new_node(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us)
+static bool ICACHE_FLASH_ATTR
+queue_put(eb_name *name, const eb_msg *msg)
 {
-  eb_event *event = event_new(event_name, cb, throttle_us);
-  if (event == NULL) return NULL;
+  eb_lane *lane = &lanes[name->prio];
 
-  eb_node *new_node = os_zalloc(sizeof(eb_node));
-  if (new_node == NULL) {
-    os_free(event);
-    return NULL;
+  if (lane->len == lane->size) {
+    lane->dropped++;
+    ESP_EB_STATS_INC(name, dropped);
+    ESP_EB_TRACE(ESP_EB_TRACE_DROPPED, name->id, ESP_EB_SUB_INVALID);
+    ESP_EB_ERROR("queue full dropping %s\n", name->name);
+    return false;
   }
-  new_node->event = event;
 
-  return new_node;
+  eb_trigger *trigger = &lane->items[(lane->head + lane->len) % lane->size];
+  trigger->id = name->id;
+  trigger->msg = *msg;
+  msg_retain(&trigger->msg);
+  lane->len++;
+  ESP_EB_STATS_QUEUE_DEPTH();
+
+  return true;
 }
 
 /**
- * Release memory allocated for node list.
+ * Add trigger to the dispatcher queue lane of the event.
  *
- * @param node The node.
+ * @param name The event.
+ * @param msg  The payload.
  */
 static void ICACHE_FLASH_ATTR
-free_node(eb_node *node)
+queue_push(eb_name *name, const eb_msg *msg)
 {
-  free_event(node->event);
-  os_free(node);
+  if (queue_put(name, msg)) task_post();
 }
 
 /**
- * Find node on the list.
- *
- * Cases:
- *                ret,  prev
- *  - empty list: NULL, NULL
- *  - head:       head, NULL
- *  - not found:  NULL, tail
- *  - found:      node, prev
+ * Start dispatcher task.
  *
- * @param event The event name.
- * @param cb    The event callback.
- * @param prev  The previous node to the found one.
+ * @param prio The SDK task priority.
  *
- * @return The found node or NULL
+ * @return true - success, false - failure
  */
-static eb_node *ICACHE_FLASH_ATTR
-find_node(const char *event_name, esp_eb_cb *cb, eb_node **prev)
+static bool ICACHE_FLASH_ATTR
+task_init(uint8_t prio)
 {
-  eb_node *curr = head;
-  if (prev != NULL && *prev != NULL) *prev = NULL;
+  if (task_ready) return task_prio == prio;
+  if (!system_os_task(task_cb, prio, task_queue, ESP_EB_TASK_QUEUE_LEN)) return false;
 
-  // Empty list.
-  if (curr == NULL) return NULL;
+  task_prio = prio;
+  task_ready = true;
 
-  while (curr) {
-    if (strcmp(curr->event->name, event_name) == 0 && curr->event->cb == cb) break;
-    if (prev != NULL) *prev = curr;
-    curr = curr->next;
+  return true;
+}
+
+// No ICACHE_FLASH_ATTR, must be in IRAM to run from interrupt handler.
+bool
+esp_eb_trigger_from_isr(esp_eb_id id, uint32_t value)
+{
+  uint8_t head = isr_head;
+
+  if (!task_ready || id >= events_cnt) return false;
+  if ((uint8_t) (head - isr_tail) == ESP_EB_ISR_QUEUE_SIZE) {
+    isr_dropped++;
+    return false;
   }
 
-  return curr;
+  eb_isr *rec = &isr_ring[head % ESP_EB_ISR_QUEUE_SIZE];
+  rec->id = id;
+  rec->value = value;
+#ifdef ESP_EB_STATS_ON
+  rec->ttime_us = system_get_time();
+#endif
+  // Publish the record after it was written.
+  isr_head = (uint8_t) (head + 1);
+
+  if (!isr_posted) isr_posted = system_os_post(task_prio, ESP_EB_SIG_ISR, 0);
+
+  return true;
 }
 
-esp_eb_err ICACHE_FLASH_ATTR
-esp_eb_attach_throttled(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us)
+uint32_t ICACHE_FLASH_ATTR
+esp_eb_isr_dropped()
 {
-  eb_node *tail = NULL;
-  eb_node *node = find_node(event_name, cb, &tail);
+  return isr_dropped;
+}
 
-  // Empty list.
-  if (node == NULL && tail == NULL) {
-    head = new_node(event_name, cb, throttle_us);
-    if (head == NULL) return ESP_EB_ATTACH_MEM;
-    ESP_EB_DEBUG("added head (%p) %s %d %p\n", head, event_name, throttle_us, cb);
+bool ICACHE_FLASH_ATTR
+esp_eb_isr_init(uint8_t prio)
+{
+  return task_init(prio);
+}
 
-    return ESP_EB_ATTACH_OK;
-  }
+bool ICACHE_FLASH_ATTR
+esp_eb_queue_init(uint8_t prio)
+{
+  if (!task_init(prio)) return false;
+  queue_mode = true;
 
-  // If node already exists we return.
-  if (node != NULL) return ESP_EB_ATTACH_EXISTED;
+  return true;
+}
 
-  tail->next = new_node(event_name, cb, throttle_us);
-  if (tail->next == NULL) return ESP_EB_ATTACH_MEM;
+uint32_t ICACHE_FLASH_ATTR
+esp_eb_queue_dropped()
+{
+  uint8_t prio;
+  uint32_t dropped = 0;
 
-  ESP_EB_DEBUG("added %s %d %p\n", event_name, throttle_us, cb);
-  return ESP_EB_ATTACH_OK;
+  for (prio = 0; prio < ESP_EB_PRIO_CNT; prio++) dropped += lanes[prio].dropped;
+
+  return dropped;
 }
 
-esp_eb_err ICACHE_FLASH_ATTR
-esp_eb_attach(const char *event, esp_eb_cb *cb)
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_queue_depth(esp_eb_prio prio)
 {
-  return esp_eb_attach_throttled(event, cb, 0);
+  if (prio >= ESP_EB_PRIO_CNT) return 0;
+
+  return lanes[prio].len;
 }
 
 bool ICACHE_FLASH_ATTR
-esp_eb_detach(const char *event_name, esp_eb_cb *cb)
+esp_eb_set_prio_id(esp_eb_id id, esp_eb_prio prio)
 {
-  eb_node *prev = NULL;
-  eb_node *curr = find_node(event_name, cb, &prev);
+  eb_name *name = get_name(id);
+  if (name == NULL || prio >= ESP_EB_PRIO_CNT) return false;
 
-  // Not found.
-  if (curr == NULL) return true;
-  if (prev != NULL) prev->next = curr->next;
-  if (curr == head) head = curr->next;
-  free_node(curr);
-
-  ESP_EB_DEBUG("detached node %s %p\n", event_name, cb);
+  name->prio = prio;
   return true;
 }
 
 bool ICACHE_FLASH_ATTR
-esp_eb_remove_cb(esp_eb_cb *cb)
+esp_eb_set_prio(const char *event, esp_eb_prio prio)
 {
-  eb_node *prev = NULL;
-  eb_node *curr = head;
+  esp_eb_id id = esp_eb_register(event);
+  if (id == ESP_EB_ID_INVALID) return false;
 
-  while (curr) {
-    if (curr->event->cb == cb) break;
-    prev = curr;
-    curr = curr->next;
-  }
+  return esp_eb_set_prio_id(id, prio);
+}
 
-  // Node not found or empty list.
-  if (curr == NULL) return true;
+/**
+ * Find triggered event and account the trigger.
+ *
+ * @param id The event ID.
+ *
+ * @return The event or NULL if it is not registered or has no subscribers.
+ */
+static eb_name *ICACHE_FLASH_ATTR
+trigger_name(esp_eb_id id)
+{
+  eb_name *name = get_name(id);
+  if (name == NULL) return NULL;
 
-  if (prev) prev->next = curr->next;
-  if (curr == head) head = curr->next;
-  free_node(curr);
+  ESP_EB_STATS_INC(name, triggers);
+  ESP_EB_TRACE(ESP_EB_TRACE_TRIGGERED, name->id, ESP_EB_SUB_INVALID);
+  if (name->head == NULL && name->wild == 0) return NULL;
 
-  ESP_EB_DEBUG("detached node %s %p\n", curr->event->name, curr->event->cb);
-  return true;
+  return name;
 }
 
 /**
- * Event timer callback.
+ * Trigger event.
  *
- * @param arg
+ * @param id    The event ID.
+ * @param mode  The dispatch mode.
+ * @param delay The delay in milliseconds (ESP_EB_MODE_TIMER only).
+ * @param arg   The argument to pass to callbacks.
+ * @param size  The number of bytes to copy from arg (0 - pass arg as is).
  */
 static void ICACHE_FLASH_ATTR
-timer_cb(void *arg)
+trigger(esp_eb_id id, eb_mode mode, uint32_t delay, const void *arg, uint16_t size)
 {
-  esp_tim_timer *timer = arg;
-  eb_event *event = timer->payload;
+  eb_msg msg;
+  eb_name *name = trigger_name(id);
+  if (name == NULL) return;
 
-  // Event no longer exists.
-  eb_node *node = find_node(event->name, event->cb, NULL);
-  if (node == NULL) {
-    free_event(event);
+  if (mode == ESP_EB_MODE_DEFAULT) mode = queue_mode ? ESP_EB_MODE_QUEUE : ESP_EB_MODE_TIMER;
+  if (mode == ESP_EB_MODE_QUEUE && !task_ready && !task_init(ESP_EB_TASK_PRIO)) {
+    ESP_EB_ERROR("error starting dispatcher task\n");
     return;
   }
 
-  uint32_t now = system_get_time();
-  uint32_t diff = now - node->event->ctime_us;
+  // Synchronous dispatch never needs a copy.
+  if (!msg_init(&msg, arg, mode == ESP_EB_MODE_SYNC ? 0 : size)) {
+    ESP_EB_STATS_INC(name, mem_errors);
+    ESP_EB_TRACE(ESP_EB_TRACE_DROPPED, name->id, ESP_EB_SUB_INVALID);
+    ESP_EB_ERROR("no memory for %s payload\n", name->name);
+    return;
+  }
+
+  switch (mode) {
+    case ESP_EB_MODE_SYNC:
+      dispatch(name, &msg);
+      break;
+
+    case ESP_EB_MODE_QUEUE:
+      queue_push(name, &msg);
+      break;
+
+    default:
+      schedule(name, &msg, delay);
+      break;
+  }
+
+  // Drop our own reference, deliveries keep theirs.
+  msg_release(&msg);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_batch(const esp_eb_trigger_req *reqs, size_t n)
+{
+  eb_batch batch = {0};
+  eb_msg msg;
+  eb_name *name;
+  bool queued = false;
+  size_t idx;
+
+  if (n == 0) return;
+
+  // All entries share one wheel deadline (or one dispatcher task wake
+  // up) and are added in request order so delivery order and
+  // cancellation are the same as for separate triggers.
+  if (!queue_mode) batch.deadline = wheel_deadline(0);
+  for (idx = 0; idx < n; idx++) {
+    name = trigger_name(reqs[idx].id);
+    if (name == NULL) continue;
 
-  if (event->throttle_us == 0) {
-    node->event->ctime_us = now;
-    event->cb(event->name, event->payload);
-  } else if (event->throttle_us > 0 && diff >= event->throttle_us) {
-    node->event->ctime_us = now;
-    event->cb(event->name, event->payload);
+    // Without copy there is nothing to release.
+    msg_init(&msg, reqs[idx].arg, 0);
+    if (queue_mode) queued |= queue_put(name, &msg);
+    else schedule_subs(name, &msg, &batch);
   }
 
-  free_event(event);
-  esp_tim_stop(timer);
+  if (queued) task_post();
+  else if (!queue_mode) wheel_add(&batch);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_delayed_id(esp_eb_id id, uint32_t delay, void *arg)
+{
+  trigger(id, ESP_EB_MODE_TIMER, delay, arg, 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_id(esp_eb_id id, void *arg)
+{
+  trigger(id, ESP_EB_MODE_DEFAULT, 0, arg, 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_asap_id(esp_eb_id id, void *arg)
+{
+  trigger(id, ESP_EB_MODE_QUEUE, 0, arg, 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_sync_id(esp_eb_id id, void *arg)
+{
+  trigger(id, ESP_EB_MODE_SYNC, 0, arg, 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_copy_id(esp_eb_id id, const void *arg, uint16_t size)
+{
+  trigger(id, ESP_EB_MODE_DEFAULT, 0, arg, size);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_delayed_copy_id(esp_eb_id id, uint32_t delay, const void *arg, uint16_t size)
+{
+  trigger(id, ESP_EB_MODE_TIMER, delay, arg, size);
+}
+
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_cancel_delayed_id(esp_eb_id id)
+{
+  if (get_name(id) == NULL) return 0;
+
+  return wheel_cancel(id);
 }
 
-static esp_tim_timer *ICACHE_FLASH_ATTR
-timer_start(const eb_node *node, void *payload, uint32_t delay)
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_cancel_delayed(const char *event)
 {
-  // We are scheduling callback, by the time it is called
-  // it is possible node will no longer exist.
-  eb_event *event = event_new(node->event->name, node->event->cb, node->event->throttle_us);
-  if (!event) return false;
-  event->payload = payload;
+  return esp_eb_cancel_delayed_id(esp_eb_lookup(event));
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_asap(const char *event, void *arg)
+{
+  esp_eb_trigger_asap_id(esp_eb_lookup(event), arg);
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_sync(const char *event, void *arg)
+{
+  esp_eb_trigger_sync_id(esp_eb_lookup(event), arg);
+}
 
-  ESP_EB_DEBUG("scheduling %s in %d ms\n", node->event->name, delay);
-  return esp_tim_start_delay(timer_cb, event, delay);
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_copy(const char *event, const void *arg, uint16_t size)
+{
+  esp_eb_trigger_copy_id(esp_eb_lookup(event), arg, size);
 }
 
 void ICACHE_FLASH_ATTR
 esp_eb_trigger_delayed(const char *event_name, uint32_t delay, void *arg)
 {
-  eb_node *curr = head;
+  esp_eb_trigger_delayed_id(esp_eb_lookup(event_name), delay, arg);
+}
 
-  while (curr) {
-    if (strcmp(curr->event->name, event_name) == 0) {
-      if (timer_start(curr, arg, delay) == NULL) {
-        ESP_EB_ERROR("error scheduling timer for %s\n", event_name);
-      }
-    }
-    curr = curr->next;
+void ICACHE_FLASH_ATTR
+esp_eb_trigger(const char *event, void *arg)
+{
+  esp_eb_trigger_id(esp_eb_lookup(event), arg);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_eb_pool_usage(esp_eb_pool pool, esp_eb_pool_info *info)
+{
+  if (pool >= ESP_EB_POOL_CNT) return false;
+
+  *info = pools[pool].info;
+  info->size = pools[pool].size;
+
+  return true;
+}
+
+#ifdef ESP_EB_STATS_ON
+
+bool ICACHE_FLASH_ATTR
+esp_eb_stats_get(esp_eb_id id, esp_eb_stats *stats)
+{
+  eb_name *name = get_name(id);
+  if (name == NULL) return false;
+
+  *stats = name->stats;
+  return true;
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_stats_latency(uint32_t *hist)
+{
+  memcpy(hist, stats_latency, sizeof(stats_latency));
+}
+
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_stats_queue_hwm()
+{
+  return stats_queue_hwm;
+}
+
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_stats_pending_hwm()
+{
+  return stats_pending_hwm;
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_stats_reset()
+{
+  esp_eb_id id;
+
+  init_events();
+  for (id = 0; id < events_cnt; id++) memset(&events[id]->stats, 0, sizeof(esp_eb_stats));
+  memset(stats_latency, 0, sizeof(stats_latency));
+  stats_queue_hwm = 0;
+  stats_pending_hwm = stats_pending;
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_stats_print()
+{
+  esp_eb_id id;
+  uint8_t bucket;
+  esp_eb_stats *st;
+
+  init_events();
+  os_printf("event stats (triggers deliveries throttled mem_errors dropped):\n");
+  for (id = 0; id < events_cnt; id++) {
+    st = &events[id]->stats;
+    if (st->triggers == 0) continue;
+    os_printf("    %s (%d) %d %d %d %d %d\n", events[id]->name, id, st->triggers,
+              st->deliveries, st->throttled, st->mem_errors, st->dropped);
+  }
+
+  os_printf("latency (us):\n");
+  for (bucket = 0; bucket < ESP_EB_LATENCY_BUCKETS; bucket++) {
+    if (stats_latency[bucket] == 0) continue;
+    os_printf("    <%d %d\n", 2 << bucket, stats_latency[bucket]);
   }
+
+  os_printf("queue hwm %d, pending hwm %d\n", stats_queue_hwm, stats_pending_hwm);
 }
 
+#endif
+
+#ifdef ESP_EB_TRACE_ON
+
 void ICACHE_FLASH_ATTR
-esp_eb_trigger(const char *event, void *arg)
+esp_eb_trace_dump()
+{
+  esp_eb_id id;
+  uint16_t idx, cnt, pos;
+  eb_trace *entry;
+
+  init_events();
+  cnt = (uint16_t) (trace_cnt < ESP_EB_TRACE_SIZE ? trace_cnt : ESP_EB_TRACE_SIZE);
+  os_printf("EBT %d %d\n", trace_cnt, cnt);
+  for (id = 0; id < events_cnt; id++) os_printf("EBN %d %s\n", id, events[id]->name);
+
+  // Oldest entry first, ESP_EB_TRACE_PER_LINE entries per line.
+  pos = (uint16_t) ((trace_head + ESP_EB_TRACE_SIZE - cnt) % ESP_EB_TRACE_SIZE);
+  for (idx = 0; idx < cnt; idx++) {
+    entry = &trace_ring[(pos + idx) % ESP_EB_TRACE_SIZE];
+    if (idx % ESP_EB_TRACE_PER_LINE == 0) os_printf("EBE");
+    os_printf(" %08x%04x%04x", entry->ts_us, entry->id, entry->info);
+    if (idx % ESP_EB_TRACE_PER_LINE == ESP_EB_TRACE_PER_LINE - 1 || idx == cnt - 1) os_printf("\n");
+  }
+
+  os_printf("EBT END\n");
+}
+
+void ICACHE_FLASH_ATTR
+esp_eb_trace_clear()
 {
-  esp_eb_trigger_delayed(event, ESP_EB_TIMER_MS, arg);
+  trace_head = 0;
+  trace_cnt = 0;
 }
 
+#endif
+
 void ICACHE_FLASH_ATTR
 esp_eb_print_list()
 {
+  esp_eb_id id;
+  uint8_t slot;
+  eb_node *node;
+
+  init_events();
   os_printf("list state:\n");
-  eb_node *node = head;
-  while (node != NULL) {
-    os_printf("    %s %p\n", node->event->name, node->event->cb);
-    node = node->next;
+  for (id = 0; id < events_cnt; id++) {
+    for (node = events[id]->head; node != NULL; node = node->next) {
+      if (node->cb == NULL) continue;
+      os_printf("    %s (%d) %p\n", events[id]->name, id, node->cb);
+    }
+  }
+  for (slot = 0; slot < ESP_EB_MAX_WILDCARDS; slot++) {
+    if (wilds[slot] == NULL) continue;
+    for (node = wilds[slot]->head; node != NULL; node = node->next) {
+      if (node->cb == NULL) continue;
+      os_printf("    %s* %p\n", wilds[slot]->prefix, node->cb);
+    }
   }
 }
 
+#ifdef ESP_EB_DEBUG_ON
+
 /**
- * The WiFi events handler.
+ * Print WiFi event details.
  *
  * @param event The WiFi event.
  */
 static void ICACHE_FLASH_ATTR
-wifi_event_cb(System_Event_t *event)
+wifi_event_debug(System_Event_t *event)
 {
+  Event_Info_u *info = &event->event_info;
+
+  ESP_EB_DEBUG("WIFI: %s\n", events[wifi_events[event->event].id]->name);
   switch (event->event) {
     case EVENT_STAMODE_CONNECTED:
-      ESP_EB_DEBUG("WIFI: EVENT_STAMODE_CONNECTED\n");
-      ESP_EB_DEBUG("      ssid    %s\n", event->event_info.connected.ssid);
-      ESP_EB_DEBUG("      bssid   " MACSTR "\n", MAC2STR(event->event_info.connected.bssid));
-      ESP_EB_DEBUG("      channel %d\n", event->event_info.connected.channel);
-      esp_eb_trigger(ESP_EB_EVENT_STAMODE_CONNECTED, (void *) event);
+      ESP_EB_DEBUG("      ssid    %s\n", info->connected.ssid);
+      ESP_EB_DEBUG("      bssid   " MACSTR "\n", MAC2STR(info->connected.bssid));
+      ESP_EB_DEBUG("      channel %d\n", info->connected.channel);
       break;
 
     case EVENT_STAMODE_DISCONNECTED:
-      ESP_EB_DEBUG("WIFI: EVENT_STAMODE_DISCONNECTED reason\n");
-      ESP_EB_DEBUG("      ssid   %s\n", event->event_info.disconnected.ssid);
-      ESP_EB_DEBUG("      bssid  " MACSTR "\n", MAC2STR(event->event_info.disconnected.bssid));
-      ESP_EB_DEBUG("      reason %d\n", event->event_info.disconnected.reason);
-      esp_eb_trigger(ESP_EB_EVENT_STAMODE_DISCONNECTED, (void *) event);
+      ESP_EB_DEBUG("      ssid   %s\n", info->disconnected.ssid);
+      ESP_EB_DEBUG("      bssid  " MACSTR "\n", MAC2STR(info->disconnected.bssid));
+      ESP_EB_DEBUG("      reason %d\n", info->disconnected.reason);
       break;
 
     case EVENT_STAMODE_AUTHMODE_CHANGE:
       // The mode is one of the AUTH_* values of AUTH_MODE defined in user_interface.h
-      os_printf("WIFI: EVENT_STAMODE_AUTHMODE_CHANGE %d -> %d\n",
-                event->event_info.auth_change.old_mode,
-                event->event_info.auth_change.new_mode);
-      esp_eb_trigger(ESP_EB_EVENT_STAMODE_AUTHMODE_CHANGE, (void *) event);
+      ESP_EB_DEBUG("      %d -> %d\n", info->auth_change.old_mode, info->auth_change.new_mode);
       break;
 
     case EVENT_STAMODE_GOT_IP:
-      ESP_EB_DEBUG("WIFI: EVENT_STAMODE_GOT_IP\n");
-      ESP_EB_DEBUG("      ip   " IPSTR "\n", IP2STR(&(event->event_info.got_ip.ip)));
-      ESP_EB_DEBUG("      mask " IPSTR "\n", IP2STR(&(event->event_info.got_ip.mask)));
-      ESP_EB_DEBUG("      gw   " IPSTR "\n", IP2STR(&(event->event_info.got_ip.gw)));
-      esp_eb_trigger(ESP_EB_EVENT_STAMODE_GOT_IP, (void *) event);
-      break;
-
-    case EVENT_STAMODE_DHCP_TIMEOUT:
-      ESP_EB_DEBUG("WIFI: EVENT_STAMODE_DHCP_TIMEOUT\n");
-      esp_eb_trigger(ESP_EB_EVENT_STAMODE_DHCP_TIMEOUT, (void *) event);
+      ESP_EB_DEBUG("      ip   " IPSTR "\n", IP2STR(&(info->got_ip.ip)));
+      ESP_EB_DEBUG("      mask " IPSTR "\n", IP2STR(&(info->got_ip.mask)));
+      ESP_EB_DEBUG("      gw   " IPSTR "\n", IP2STR(&(info->got_ip.gw)));
       break;
 
     case EVENT_SOFTAPMODE_STACONNECTED:
-      ESP_EB_DEBUG("WIFI: EVENT_SOFTAPMODE_STACONNECTED\n");
-      ESP_EB_DEBUG("      aid %d\n", event->event_info.sta_connected.aid);
-      ESP_EB_DEBUG("      mac " MACSTR "\n", MAC2STR(event->event_info.sta_connected.mac));
-      esp_eb_trigger(ESP_EB_EVENT_SOFTAPMODE_STACONNECTED, (void *) event);
+      ESP_EB_DEBUG("      aid %d\n", info->sta_connected.aid);
+      ESP_EB_DEBUG("      mac " MACSTR "\n", MAC2STR(info->sta_connected.mac));
       break;
 
     case EVENT_SOFTAPMODE_STADISCONNECTED:
-      ESP_EB_DEBUG("WIFI: EVENT_SOFTAPMODE_STADISCONNECTED\n");
-      ESP_EB_DEBUG("      aid %d\n", event->event_info.sta_connected.aid);
-      ESP_EB_DEBUG("      mac " MACSTR "\n", MAC2STR(event->event_info.sta_disconnected.mac));
-      esp_eb_trigger(ESP_EB_EVENT_SOFTAPMODE_STADISCONNECTED, (void *) event);
+      ESP_EB_DEBUG("      aid %d\n", info->sta_disconnected.aid);
+      ESP_EB_DEBUG("      mac " MACSTR "\n", MAC2STR(info->sta_disconnected.mac));
       break;
 
     case EVENT_OPMODE_CHANGED:
-      ESP_EB_DEBUG("WIFI: EVENT_OPMODE_CHANGED %d -> %d\n",
-                event->event_info.opmode_changed.old_opmode,
-                event->event_info.opmode_changed.new_opmode);
-      esp_eb_trigger(ESP_EB_EVENT_OPMODE_CHANGED, (void *) event);
+      ESP_EB_DEBUG("      %d -> %d\n", info->opmode_changed.old_opmode, info->opmode_changed.new_opmode);
       break;
 
     case EVENT_SOFTAPMODE_PROBEREQRECVED:
-      ESP_EB_DEBUG("WIFI: EVENT_SOFTAPMODE_PROBEREQRECVED\n");
-      ESP_EB_DEBUG("      rssi %d\n", event->event_info.ap_probereqrecved.rssi);
-      ESP_EB_DEBUG("      mac  " MACSTR "\n", MAC2STR(event->event_info.ap_probereqrecved.mac));
-      esp_eb_trigger(ESP_EB_EVENT_SOFTAPMODE_PROBEREQRECVED, (void *) event);
+      ESP_EB_DEBUG("      rssi %d\n", info->ap_probereqrecved.rssi);
+      ESP_EB_DEBUG("      mac  " MACSTR "\n", MAC2STR(info->ap_probereqrecved.mac));
       break;
 
     default:
-      ESP_EB_ERROR("unexpected wifi event: %d\n", event->event);
       break;
   }
 }
 
+  #define ESP_EB_WIFI_DEBUG(event) wifi_event_debug(event)
+#else
+  #define ESP_EB_WIFI_DEBUG(event) do {} while(0)
+#endif
+
+/**
+ * The WiFi events handler.
+ *
+ * Events without subscribers are skipped before doing any work.
+ * Subscribers get a copy of the event_info union member.
+ *
+ * @param event The WiFi event.
+ */
+static void ICACHE_FLASH_ATTR
+wifi_event_cb(System_Event_t *event)
+{
+  const eb_wifi *bridge;
+  eb_name *name;
+
+  if ((uint32_t) event->event >= sizeof(wifi_events) / sizeof(wifi_events[0])) {
+    ESP_EB_ERROR("unexpected wifi event: %d\n", event->event);
+    return;
+  }
+
+  bridge = &wifi_events[event->event];
+  name = get_name(bridge->id);
+  if (name->head == NULL && name->wild == 0) return;
+
+  ESP_EB_WIFI_DEBUG(event);
+  esp_eb_trigger_copy_id(bridge->id, bridge->size ? &event->event_info : NULL, bridge->size);
+}
+
 void ICACHE_FLASH_ATTR
 esp_eb_handle_wifi_events()
 {
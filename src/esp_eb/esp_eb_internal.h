@@ -28,4 +28,46 @@
 
 #define ESP_EB_ERROR(format, ...) os_printf("EB ERR: " format, ## __VA_ARGS__ )
 
+// The length of the SDK message queue for dispatcher task.
+#define ESP_EB_TASK_QUEUE_LEN 4
+
+// Dispatcher task signals.
+#define ESP_EB_SIG_QUEUE 0 // Posted by trigger functions.
+#define ESP_EB_SIG_ISR 1   // Posted from interrupt handlers.
+
+// The maximum number of triggers dispatched in one task run.
+#define ESP_EB_TASK_BATCH 8
+
+// Not a wildcard subscription slot.
+#define ESP_EB_WILD_NONE 0xFF
+
+// The maximum wildcard pattern length without trailing '*'.
+#define ESP_EB_WILD_LEN_MAX 255
+
+// Invalid subscriber handle.
+#define ESP_EB_SUB_INVALID 0xFFFFFFFF
+
+// No subscriber handle table entry.
+#define ESP_EB_HANDLE_NONE 0xFFFF
+
+// Trace entry phases.
+#define ESP_EB_TRACE_TRIGGERED 0  // Event triggered.
+#define ESP_EB_TRACE_DISPATCHED 1 // Subscriber callback called.
+#define ESP_EB_TRACE_THROTTLED 2  // Subscriber callback skipped.
+#define ESP_EB_TRACE_DROPPED 3    // Trigger or delivery dropped.
+
+// Trace entry subscriber index mask, also used when there is no subscriber.
+#define ESP_EB_TRACE_SUB_NONE 0x3FFF
+
+// The number of trace entries per line in trace dump.
+#define ESP_EB_TRACE_PER_LINE 4
+
+// Trigger dispatch modes.
+typedef enum {
+  ESP_EB_MODE_DEFAULT, // ESP_EB_MODE_QUEUE after esp_eb_queue_init otherwise ESP_EB_MODE_TIMER.
+  ESP_EB_MODE_TIMER,   // Timing wheel, every subscriber gets its own entry.
+  ESP_EB_MODE_QUEUE,   // Dispatcher task queue.
+  ESP_EB_MODE_SYNC     // Call subscribers right away.
+} eb_mode;
+
 #endif //ESP_EB_INTERNAL_H
@@ -27,20 +27,153 @@
   #endif
 #endif
 
-// The number of milliseconds to use when arming the event callback timer.
+// Define ESP_EB_STATS_ON to collect event bus statistics.
+
+// The number of dispatch latency histogram buckets.
+// Bucket N counts latencies below 2^(N+1) microseconds,
+// the last one counts everything above.
+#define ESP_EB_LATENCY_BUCKETS 16
+
+// Define ESP_EB_TRACE_ON to record binary event trace.
+
+// The number of trace ring buffer entries (8 bytes each).
+#ifndef ESP_EB_TRACE_SIZE
+  #define ESP_EB_TRACE_SIZE 128
+#endif
+
+// The default timing wheel tick in milliseconds. Timer mode triggers
+// without delay are delivered at the next tick, at most this late.
 #define ESP_EB_TIMER_MS 10
 
+// The number of event name hash table buckets.
+#ifndef ESP_EB_BUCKETS
+  #define ESP_EB_BUCKETS 16
+#endif
+
+// The maximum number of registered user events, built in WiFi events
+// (ESP_EB_ID_*) don't count. Registered names are never released so
+// the table only grows. Every event costs a pointer plus its record.
+#ifndef ESP_EB_MAX_EVENTS
+  #define ESP_EB_MAX_EVENTS 48
+#endif
+
+// The capacities of the trigger queue lanes used in queued dispatch mode.
+#ifndef ESP_EB_QUEUE_SIZE_HIGH
+  #define ESP_EB_QUEUE_SIZE_HIGH 8
+#endif
+#ifndef ESP_EB_QUEUE_SIZE
+  #define ESP_EB_QUEUE_SIZE 32
+#endif
+#ifndef ESP_EB_QUEUE_SIZE_LOW
+  #define ESP_EB_QUEUE_SIZE_LOW 16
+#endif
+
+// The SDK task priority of the dispatcher task started by
+// esp_eb_trigger_asap when esp_eb_queue_init was not called.
+#ifndef ESP_EB_TASK_PRIO
+  #define ESP_EB_TASK_PRIO 1 // USER_TASK_PRIO_1
+#endif
+
+// The timing wheel of timer mode deliveries: the tick period in
+// milliseconds and the number of slots. Delays longer than
+// ESP_EB_WHEEL_TICK_MS * ESP_EB_WHEEL_SLOTS take more wheel rounds.
+#ifndef ESP_EB_WHEEL_TICK_MS
+  #define ESP_EB_WHEEL_TICK_MS ESP_EB_TIMER_MS
+#endif
+#ifndef ESP_EB_WHEEL_SLOTS
+  #define ESP_EB_WHEEL_SLOTS 32 // Up to 256.
+#endif
+
+// The capacity of the interrupt trigger ring (power of 2, up to 128).
+#ifndef ESP_EB_ISR_QUEUE_SIZE
+  #define ESP_EB_ISR_QUEUE_SIZE 16
+#endif
+#if ESP_EB_ISR_QUEUE_SIZE < 1 || ESP_EB_ISR_QUEUE_SIZE > 128 || \
+    (ESP_EB_ISR_QUEUE_SIZE & (ESP_EB_ISR_QUEUE_SIZE - 1))
+  #error "ESP_EB_ISR_QUEUE_SIZE must be a power of 2 up to 128"
+#endif
+
+// The maximum number of distinct wildcard patterns (up to 32).
+#ifndef ESP_EB_MAX_WILDCARDS
+  #define ESP_EB_MAX_WILDCARDS 8
+#endif
+#if ESP_EB_MAX_WILDCARDS < 1 || ESP_EB_MAX_WILDCARDS > 32
+  #error "ESP_EB_MAX_WILDCARDS must be between 1 and 32"
+#endif
+
+// The number of statically allocated subscriber records (at least 1).
+// When they are used up records are allocated on the heap.
+#ifndef ESP_EB_POOL_NODES
+  #define ESP_EB_POOL_NODES 16
+#endif
+
+// The number of statically allocated scheduled delivery records (at least 1).
+#ifndef ESP_EB_POOL_EVENTS
+  #define ESP_EB_POOL_EVENTS 16
+#endif
+
+// The event ID.
+typedef uint16_t esp_eb_id;
+
+// Invalid or not registered event ID.
+#define ESP_EB_ID_INVALID 0xFFFF
+
+// Event priorities. Queued triggers of higher priority
+// events are always dispatched before lower priority ones.
+typedef enum {
+  ESP_EB_PRIO_HIGH,
+  ESP_EB_PRIO_NORMAL, // Default for user events.
+  ESP_EB_PRIO_LOW,
+  ESP_EB_PRIO_CNT
+} esp_eb_prio;
+
+// Record pools.
+typedef enum {
+  ESP_EB_POOL_NODE,  // Subscribers.
+  ESP_EB_POOL_EVENT, // Scheduled deliveries.
+  ESP_EB_POOL_CNT
+} esp_eb_pool;
+
+// Record pool usage.
+typedef struct {
+  uint16_t size; // The number of records in the pool.
+  uint16_t used; // The number of records taken from the pool.
+  uint16_t hwm;  // The maximum number of records taken from the pool.
+  uint16_t heap; // The number of records allocated on heap (pool exhausted).
+} esp_eb_pool_info;
+
+// Event statistics.
+typedef struct {
+  uint32_t triggers;   // Number of triggers.
+  uint32_t deliveries; // Number of callback calls.
+  uint32_t throttled;  // Number of callback calls skipped by throttling.
+  uint32_t mem_errors; // Number of deliveries not scheduled (out of memory).
+  uint32_t dropped;    // Number of triggers dropped because queue was full.
+} esp_eb_stats;
+
 // The event callback prototype.
 typedef void (esp_eb_cb)(const char *event, void *arg);
 
+// Batched trigger request.
+typedef struct {
+  esp_eb_id id; // The event ID.
+  void *arg;    // The argument to pass to all subscribers.
+} esp_eb_trigger_req;
+
 // Event bus errors.
 typedef enum {
   ESP_EB_ATTACH_OK,
   ESP_EB_ATTACH_EXISTED,
-  ESP_EB_ATTACH_MEM // Out of memory.
+  ESP_EB_ATTACH_MEM,  // Out of memory.
+  ESP_EB_ATTACH_FULL, // No room for new event or pattern (see ESP_EB_MAX_*).
+  ESP_EB_ATTACH_ID,   // Unknown event ID.
+  ESP_EB_ATTACH_NAME  // Wildcard pattern too long (up to 255 characters before '*').
 } esp_eb_err;
 
-// The available for attaching wifi events.
+// The available for attaching wifi events. Subscribers get pointer to
+// the copy of matching System_Event_t event_info union member
+// (e.g. Event_StaMode_Got_IP_t *) valid only during the callback.
+// ESP_EB_EVENT_STAMODE_DHCP_TIMEOUT passes NULL.
 #define ESP_EB_EVENT_STAMODE_CONNECTED "espEbStaConn"
 #define ESP_EB_EVENT_STAMODE_DISCONNECTED "espEbStaDisc"
 #define ESP_EB_EVENT_STAMODE_AUTHMODE_CHANGE "espEbStaAuth"
@@ -51,9 +184,64 @@ typedef enum {
 #define ESP_EB_EVENT_OPMODE_CHANGED "espEbOp"
 #define ESP_EB_EVENT_SOFTAPMODE_PROBEREQRECVED "espEbStaPro"
 
+// The IDs of built in wifi events. They are always registered
+// and have ESP_EB_PRIO_HIGH priority.
+#define ESP_EB_ID_STAMODE_CONNECTED 0
+#define ESP_EB_ID_STAMODE_DISCONNECTED 1
+#define ESP_EB_ID_STAMODE_AUTHMODE_CHANGE 2
+#define ESP_EB_ID_STAMODE_GOT_IP 3
+#define ESP_EB_ID_STAMODE_DHCP_TIMEOUT 4
+#define ESP_EB_ID_SOFTAPMODE_STACONNECTED 5
+#define ESP_EB_ID_SOFTAPMODE_STADISCONNECTED 6
+#define ESP_EB_ID_OPMODE_CHANGED 7
+#define ESP_EB_ID_SOFTAPMODE_PROBEREQRECVED 8
+#define ESP_EB_ID_BUILTIN_CNT 9
+
+/**
+ * Register event name and get its ID.
+ *
+ * Registering already registered event returns the same ID.
+ * Registered events are never released.
+ *
+ * @param event The event name.
+ *
+ * @return The event ID or ESP_EB_ID_INVALID on error.
+ */
+esp_eb_id ICACHE_FLASH_ATTR
+esp_eb_register(const char *event);
+
+/**
+ * Get ID of registered event.
+ *
+ * @param event The event name.
+ *
+ * @return The event ID or ESP_EB_ID_INVALID if event is not registered.
+ */
+esp_eb_id ICACHE_FLASH_ATTR
+esp_eb_lookup(const char *event);
+
+/**
+ * Get name of registered event.
+ *
+ * Subscribers get the same pointer as the event name so it can
+ * be compared with it.
+ *
+ * @param id The event ID.
+ *
+ * @return The event name or NULL if ID is not registered.
+ */
+const char *ICACHE_FLASH_ATTR
+esp_eb_name(esp_eb_id id);
+
 /**
  * Subscribe to event.
  *
+ * Event name ending with '*' is a wildcard pattern subscribing to all
+ * events starting with given prefix (e.g. "espEbSta*"). Patterns are
+ * matched against event names only when events or patterns are added
+ * so wildcard subscriptions cost nothing extra on trigger. The same is
+ * true for all esp_eb_attach* and esp_eb_detach functions taking names.
+ *
  * @param event       The event name.
  * @param cb          The event callback.
  *
@@ -75,6 +263,86 @@ esp_eb_attach(const char *event, esp_eb_cb *cb);
 esp_eb_err ICACHE_FLASH_ATTR
 esp_eb_attach_throttled(const char *event_name, esp_eb_cb *cb, uint32_t throttle_us);
 
+/**
+ * Subscribe to event and coalesce callbacks.
+ *
+ * The first trigger opens window_us long window. Only the newest
+ * payload triggered during the window is kept and delivered once
+ * at the end of the window.
+ *
+ * @param event     The event name.
+ * @param cb        The event callback.
+ * @param window_us The window length in microseconds (millisecond resolution).
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_coalesced(const char *event, esp_eb_cb *cb, uint32_t window_us);
+
+/**
+ * Subscribe to event and debounce callbacks.
+ *
+ * Works like esp_eb_attach_coalesced but every trigger restarts
+ * the window so the newest payload is delivered after window_us
+ * without triggers (trailing edge).
+ *
+ * @param event     The event name.
+ * @param cb        The event callback.
+ * @param window_us The window length in microseconds (millisecond resolution).
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_debounced(const char *event, esp_eb_cb *cb, uint32_t window_us);
+
+/**
+ * Subscribe to registered event.
+ *
+ * @param id The event ID.
+ * @param cb The event callback.
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_id(esp_eb_id id, esp_eb_cb *cb);
+
+/**
+ * Subscribe to registered event and throttle callbacks.
+ *
+ * @param id          The event ID.
+ * @param cb          The event callback.
+ * @param throttle_us Wait at least microseconds between callback executions.
+ *                    Turn off throttling by passing 0.
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_throttled_id(esp_eb_id id, esp_eb_cb *cb, uint32_t throttle_us);
+
+/**
+ * Subscribe to registered event and coalesce callbacks.
+ *
+ * @param id        The event ID.
+ * @param cb        The event callback.
+ * @param window_us The window length in microseconds (millisecond resolution).
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_coalesced_id(esp_eb_id id, esp_eb_cb *cb, uint32_t window_us);
+
+/**
+ * Subscribe to registered event and debounce callbacks.
+ *
+ * @param id        The event ID.
+ * @param cb        The event callback.
+ * @param window_us The window length in microseconds (millisecond resolution).
+ *
+ * @return The result of adding new subscriber.
+ */
+esp_eb_err ICACHE_FLASH_ATTR
+esp_eb_attach_debounced_id(esp_eb_id id, esp_eb_cb *cb, uint32_t window_us);
+
 /**
  * Stop event subscription.
  *
@@ -86,9 +354,24 @@ esp_eb_attach_throttled(const char *event_name, esp_eb_cb *cb, uint32_t throttle
 bool ICACHE_FLASH_ATTR
 esp_eb_detach(const char *event, esp_eb_cb *cb);
 
+/**
+ * Stop registered event subscription.
+ *
+ * @param id The event ID.
+ * @param cb The event callback.
+ *
+ * @return true - success, false - failure
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_detach_id(esp_eb_id id, esp_eb_cb *cb);
+
 /**
  * Remove all event subscriptions with given callback.
  *
+ * Removes the callback from every event and wildcard pattern. It is
+ * safe to call from callbacks, pending deliveries to removed
+ * subscriptions are dropped.
+ *
  * @param cb The event callback.
  *
  * @return true - success, false - failure
@@ -115,15 +398,349 @@ esp_eb_trigger(const char *event, void *arg);
 void ICACHE_FLASH_ATTR
 esp_eb_trigger_delayed(const char *event_name, uint32_t delay, void *arg);
 
+/**
+ * Trigger registered event and notify all subscribers.
+ *
+ * @param id  The event ID.
+ * @param arg The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_id(esp_eb_id id, void *arg);
+
+/**
+ * Trigger registered event and notify all subscribers after delay.
+ *
+ * @param id    The event ID.
+ * @param delay The delay in milliseconds.
+ * @param arg   The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_delayed_id(esp_eb_id id, uint32_t delay, void *arg);
+
+/**
+ * Trigger event and notify all subscribers synchronously.
+ *
+ * Callbacks are called before this function returns. It is safe
+ * to trigger events or attach / detach subscribers from callbacks.
+ *
+ * @param event The event name to trigger.
+ * @param arg   The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_sync(const char *event, void *arg);
+
+/**
+ * Trigger registered event and notify all subscribers synchronously.
+ *
+ * @param id  The event ID.
+ * @param arg The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_sync_id(esp_eb_id id, void *arg);
+
+/**
+ * Trigger event and notify all subscribers as soon as possible.
+ *
+ * The trigger is put on dispatcher queue and callbacks are called
+ * from the next SDK task run instead of the next timing wheel tick.
+ * Starts dispatcher task with ESP_EB_TASK_PRIO if esp_eb_queue_init
+ * was not called before.
+ *
+ * @param event The event name to trigger.
+ * @param arg   The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_asap(const char *event, void *arg);
+
+/**
+ * Trigger registered event and notify all subscribers as soon as possible.
+ *
+ * @param id  The event ID.
+ * @param arg The optional argument to pass to all subscribers.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_asap_id(esp_eb_id id, void *arg);
+
+/**
+ * Trigger event with a copy of the argument.
+ *
+ * The size bytes pointed by arg are copied once to the reference
+ * counted buffer shared by all subscribers of this trigger. The buffer
+ * is released after the last callback returns so arg may point to
+ * the stack. Callbacks must not keep the pointer they get.
+ *
+ * @param event The event name to trigger.
+ * @param arg   The argument to copy.
+ * @param size  The number of bytes to copy.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_copy(const char *event, const void *arg, uint16_t size);
+
+/**
+ * Trigger registered event with a copy of the argument.
+ *
+ * @param id   The event ID.
+ * @param arg  The argument to copy.
+ * @param size The number of bytes to copy.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_copy_id(esp_eb_id id, const void *arg, uint16_t size);
+
+/**
+ * Trigger registered event with a copy of the argument after delay.
+ *
+ * @param id    The event ID.
+ * @param delay The delay in milliseconds.
+ * @param arg   The argument to copy.
+ * @param size  The number of bytes to copy.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_delayed_copy_id(esp_eb_id id, uint32_t delay, const void *arg, uint16_t size);
+
+/**
+ * Cancel scheduled deliveries of the event.
+ *
+ * Drops deliveries waiting on the timing wheel (esp_eb_trigger_delayed
+ * and timer mode triggers). It does not touch queued triggers and
+ * coalesced / debounced payloads.
+ *
+ * @param event The event name.
+ *
+ * @return The number of dropped deliveries.
+ */
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_cancel_delayed(const char *event);
+
+/**
+ * Cancel scheduled deliveries of the registered event.
+ *
+ * @param id The event ID.
+ *
+ * @return The number of dropped deliveries.
+ */
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_cancel_delayed_id(esp_eb_id id);
+
+/**
+ * Trigger many registered events at once.
+ *
+ * Delivers like n separate esp_eb_trigger_id calls: subscribers
+ * are resolved when the function is called, deliveries keep request
+ * order and can be cancelled with esp_eb_cancel_delayed_id.
+ * The timing wheel deadline is computed once and all entries are
+ * appended to its slot in one pass, in queued mode the dispatcher
+ * task is woken up once.
+ *
+ * @param reqs The trigger requests.
+ * @param n    The number of requests.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trigger_batch(const esp_eb_trigger_req *reqs, size_t n);
+
+/**
+ * Trigger registered event from interrupt handler.
+ *
+ * The trigger is put on lock free single producer / single consumer
+ * ring (ESP_EB_ISR_QUEUE_SIZE) and dispatcher task is woken up.
+ * Subscribers are called from the next task run before the triggers
+ * waiting in the dispatcher queue. The value is passed to callbacks
+ * as the arg pointer: (uint32_t) arg.
+ *
+ * The dispatcher task must be started before the interrupt is enabled
+ * (esp_eb_isr_init or esp_eb_queue_init) and the event must be already
+ * registered.
+ * The function is placed in IRAM and only one interrupt handler
+ * may trigger events at a time.
+ *
+ * @param id    The event ID.
+ * @param value The value to pass to subscribers.
+ *
+ * @return true on success, false if ring is full or task not started.
+ */
+bool
+esp_eb_trigger_from_isr(esp_eb_id id, uint32_t value);
+
+/**
+ * Get the number of interrupt triggers dropped because ring was full.
+ *
+ * @return The number of dropped triggers.
+ */
+uint32_t ICACHE_FLASH_ATTR
+esp_eb_isr_dropped();
+
+/**
+ * Start dispatcher task for esp_eb_trigger_from_isr.
+ *
+ * Unlike esp_eb_queue_init it doesn't change the dispatch mode,
+ * esp_eb_trigger* functions keep using the timing wheel.
+ *
+ * @param prio The SDK task priority (USER_TASK_PRIO_0 - USER_TASK_PRIO_2)
+ *             not used by any other task.
+ *             Fails if dispatcher task is already running with
+ *             different priority.
+ *
+ * @return true - success, false - failure
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_isr_init(uint8_t prio);
+
+/**
+ * Switch to queued dispatch mode.
+ *
+ * In queued mode esp_eb_trigger* functions (except the delayed ones)
+ * put triggers in fixed capacity ring buffers (one per event priority)
+ * drained by single SDK task. No memory is allocated per trigger.
+ * When queue lane is full the trigger is dropped (see esp_eb_queue_dropped).
+ *
+ * @param prio The SDK task priority (USER_TASK_PRIO_0 - USER_TASK_PRIO_2)
+ *             not used by any other task.
+ *             Fails if dispatcher task is already running with
+ *             different priority.
+ *
+ * @return true - success, false - failure
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_queue_init(uint8_t prio);
+
+/**
+ * Get the number of triggers dropped because queue was full.
+ *
+ * @return The number of dropped triggers.
+ */
+uint32_t ICACHE_FLASH_ATTR
+esp_eb_queue_dropped();
+
+/**
+ * Get the number of triggers waiting in the queue lane.
+ *
+ * @param prio The lane priority.
+ *
+ * @return The number of queued triggers.
+ */
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_queue_depth(esp_eb_prio prio);
+
+/**
+ * Set event priority.
+ *
+ * Registers the event if needed. In queue mode the priority decides
+ * which dispatcher queue lane event triggers go to. In timer mode
+ * (default) deliveries due at the same timing wheel tick are made in
+ * priority order. Synchronous triggers are never reordered.
+ *
+ * @param event The event name.
+ * @param prio  The priority.
+ *
+ * @return true - success, false - failure
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_set_prio(const char *event, esp_eb_prio prio);
+
+/**
+ * Set registered event priority.
+ *
+ * @param id   The event ID.
+ * @param prio The priority.
+ *
+ * @return true - success, false - failure
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_set_prio_id(esp_eb_id id, esp_eb_prio prio);
+
 /**
  * Make esp_eb to trigger events on WiFi events.
  *
  * After calling this function you will be able to
- * attach callbacks to ESP_EB_EVENT_* events.
+ * attach callbacks to ESP_EB_EVENT_* events. WiFi events
+ * without subscribers are ignored.
  */
 void ICACHE_FLASH_ATTR
 esp_eb_handle_wifi_events();
 
+/**
+ * Get record pool usage.
+ *
+ * @param pool The pool.
+ * @param info The structure to fill.
+ *
+ * @return true - success, false - unknown pool.
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_pool_usage(esp_eb_pool pool, esp_eb_pool_info *info);
+
+#ifdef ESP_EB_STATS_ON
+
+/**
+ * Get registered event statistics.
+ *
+ * @param id    The event ID.
+ * @param stats The structure to fill.
+ *
+ * @return true - success, false - unknown event ID.
+ */
+bool ICACHE_FLASH_ATTR
+esp_eb_stats_get(esp_eb_id id, esp_eb_stats *stats);
+
+/**
+ * Get trigger to callback latency histogram.
+ *
+ * @param hist The array of ESP_EB_LATENCY_BUCKETS elements.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_stats_latency(uint32_t *hist);
+
+/**
+ * Get the maximum number of triggers waiting in the dispatcher queue.
+ *
+ * @return The queue depth high-water mark.
+ */
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_stats_queue_hwm();
+
+/**
+ * Get the maximum number of timer scheduled deliveries.
+ *
+ * @return The scheduled deliveries high-water mark.
+ */
+uint16_t ICACHE_FLASH_ATTR
+esp_eb_stats_pending_hwm();
+
+/**
+ * Reset all statistics.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_stats_reset();
+
+/**
+ * Print statistics.
+ *
+ * For debugging purposes.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_stats_print();
+
+#endif
+
+#ifdef ESP_EB_TRACE_ON
+
+/**
+ * Dump trace ring buffer over UART.
+ *
+ * Prints the number of recorded entries, registered event names and
+ * hex encoded entries (oldest first). Use bin/eb_trace.py to decode
+ * the output into a timeline.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trace_dump();
+
+/**
+ * Clear trace ring buffer.
+ */
+void ICACHE_FLASH_ATTR
+esp_eb_trace_clear();
+
+#endif
+
 /**
  * Print elements in the event list.
  *
@@ -23,6 +23,9 @@
 #   esp_tim_LIBRARY      - The path to the library.
 #   esp_tim_LIBRARIES    - The dependencies to link to use the library.
 #                          It will have a form of <lib_name>_LIBRARY [dep1_name_LIBRARIES, ...].
+#   esp_tim_DEFINITIONS  - Compiler definitions the library was built with
+#                          (taken from ESP_TIM_STATS_ON environment variable).
+#                          Added with add_definitions.
 #
 
 
@@ -37,3 +40,10 @@ FIND_PACKAGE_HANDLE_STANDARD_ARGS(esp_tim
 
 set(esp_tim_INCLUDE_DIRS ${esp_tim_INCLUDE_DIR})
 set(esp_tim_LIBRARIES ${esp_tim_LIBRARY})
+
+# Statistics change public structures, must match the library build.
+set(esp_tim_DEFINITIONS)
+if($ENV{ESP_TIM_STATS_ON})
+  list(APPEND esp_tim_DEFINITIONS -DESP_TIM_STATS_ON)
+endif()
+add_definitions(${esp_tim_DEFINITIONS})
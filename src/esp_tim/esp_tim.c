@@ -17,27 +17,159 @@
 
 #include <mem.h>
 #include <osapi.h>
+#include <user_interface.h>
 #include "include/esp_tim.h"
 
+// Logical timer is not armed.
+#define ESP_TIM_MUX_IDLE 0xFFFF
 
-esp_tim_timer *ICACHE_FLASH_ATTR
-esp_tim_start_delay(os_timer_func_t *cb, void *payload, uint32_t delay)
+// Is deadline a before deadline b (wrap around aware).
+#define ESP_TIM_BEFORE(a, b) ((int32_t) ((a) - (b)) < 0)
+
+// The latest time logical timer callback may run.
+#define ESP_TIM_EXPIRY(t) ((t)->deadline_us + (t)->slack_us)
+
+#ifdef USE_US_TIMER
+  // The longest delay of the SDK microsecond timer.
+  #define ESP_TIM_US_MAX 0xFFFFFFF
+#else
+  // The longest delay of FRC1 timer (23 bit counter).
+  #define ESP_TIM_US_MAX 0x199999
+  // FRC1 ticks per microsecond (80MHz APB clock divided by 16).
+  #define ESP_TIM_FRC1_TICKS_US 5
+  // FRC1 control register bits (see hw_timer.c in SDK examples).
+  #define ESP_TIM_FRC1_ENABLE BIT7
+  #define ESP_TIM_FRC1_DIV16 4
+  #define ESP_TIM_FRC1_EDGE_INT 0
+  // The interrupt posts at most one run of the FRC1 task at a time.
+  #define ESP_TIM_US_TASK_QUEUE_LEN 1
+#endif
+
+// Multiplexer of microsecond timers.
+static esp_tim_mux us_mux;
+static bool us_mux_ready;
+
+#ifndef USE_US_TIMER
+// The task running FRC1 timers.
+static os_event_t us_task_queue[ESP_TIM_US_TASK_QUEUE_LEN];
+#endif
+
+// Microsecond timers jitter measurements.
+static esp_tim_us_info us_info;
+static uint32_t us_late_sum;
+
+static void ICACHE_FLASH_ATTR
+us_timer_cb(void *arg);
+
+static esp_tim_mux *ICACHE_FLASH_ATTR
+us_mux_get();
+
+#ifdef ESP_TIM_STATS_ON
+
+/**
+ * Add measurement to histogram.
+ *
+ * @param hist  The histogram.
+ * @param calls The number of measurements including this one.
+ * @param value The measurement in microseconds.
+ */
+static void ICACHE_FLASH_ATTR
+stats_add(esp_tim_hist *hist, uint32_t calls, uint32_t value)
 {
-  esp_tim_timer *timer = os_zalloc(sizeof(esp_tim_timer));
-  if (timer == NULL) return NULL;
+  uint8_t bucket = 0;
 
-  timer->_os_timer = os_zalloc(sizeof(os_timer_t));
-  if (timer->_os_timer == NULL) {
-    os_free(timer);
-    return NULL;
+  if (calls == 1 || value < hist->min) hist->min = value;
+  if (value > hist->max) hist->max = value;
+  hist->sum += value;
+
+  while (value > 1 && bucket < ESP_TIM_STATS_BUCKETS - 1) {
+    value >>= 1;
+    bucket++;
   }
 
+  if (hist->hist[bucket] < 0xFFFF) hist->hist[bucket]++;
+}
+
+/**
+ * Call timer callback measuring its lateness and duration.
+ *
+ * @param stats       The timer statistics.
+ * @param cb          The callback.
+ * @param arg         The callback argument.
+ * @param deadline_us The timer expiry time.
+ */
+static void ICACHE_FLASH_ATTR
+stats_call(esp_tim_stats *stats, os_timer_func_t *cb, void *arg, uint32_t deadline_us)
+{
+  uint32_t start = system_get_time();
+
+  stats->calls++;
+  stats_add(&stats->late, stats->calls, ESP_TIM_BEFORE(start, deadline_us) ? 0 : start - deadline_us);
+  cb(arg);
+  stats_add(&stats->run, stats->calls, system_get_time() - start);
+}
+
+/**
+ * Timer callback trampoline measuring the callback.
+ *
+ * Timers stopped by their callback are released here
+ * after the measurement.
+ *
+ * @param arg The timer.
+ */
+static void ICACHE_FLASH_ATTR
+stats_timer_cb(void *arg)
+{
+  esp_tim_timer *timer = arg;
+
+  timer->_in_cb = true;
+  stats_call(&timer->stats, timer->os_timer_cb, timer, timer->_deadline_us);
+  timer->_in_cb = false;
+  if (timer->_free) os_free(timer);
+}
+
+  #define ESP_TIM_TIMER_CB(timer) stats_timer_cb
+  #define ESP_TIM_DEADLINE(timer, deadline) ((timer)->_deadline_us = (deadline))
+  // Microsecond timers measure themselves and may be released by callback.
+  #define ESP_TIM_MUX_CALL(timer, deadline_us) \
+    ((timer)->cb == us_timer_cb ? (timer)->cb(timer) \
+                                : stats_call(&(timer)->stats, (timer)->cb, (timer), (deadline_us)))
+#else
+  #define ESP_TIM_TIMER_CB(timer) ((timer)->os_timer_cb)
+  #define ESP_TIM_DEADLINE(timer, deadline) do {} while(0)
+  #define ESP_TIM_MUX_CALL(timer, deadline_us) ((void) (deadline_us), (timer)->cb(timer))
+#endif
+
+
+void ICACHE_FLASH_ATTR
+esp_tim_init(esp_tim_timer *timer, os_timer_func_t *cb, void *payload, uint32_t delay)
+{
+  os_memset(timer, 0, sizeof(esp_tim_timer));
   timer->os_timer_cb = cb;
   timer->delay = delay;
   timer->payload = payload;
 
-  os_timer_setfn(timer->_os_timer, timer->os_timer_cb, (void *) timer);
-  os_timer_arm(timer->_os_timer, delay, false);
+  os_timer_setfn(&timer->_os_timer, ESP_TIM_TIMER_CB(timer), (void *) timer);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_arm(esp_tim_timer *timer)
+{
+  os_timer_disarm(&timer->_os_timer);
+  os_timer_setfn(&timer->_os_timer, ESP_TIM_TIMER_CB(timer), (void *) timer);
+  ESP_TIM_DEADLINE(timer, system_get_time() + timer->delay * 1000);
+  os_timer_arm(&timer->_os_timer, timer->delay, false);
+}
+
+esp_tim_timer *ICACHE_FLASH_ATTR
+esp_tim_start_delay(os_timer_func_t *cb, void *payload, uint32_t delay)
+{
+  esp_tim_timer *timer = os_malloc(sizeof(esp_tim_timer));
+  if (timer == NULL) return NULL;
+
+  esp_tim_init(timer, cb, payload, delay);
+  timer->_allocated = true;
+  esp_tim_arm(timer);
 
   return timer;
 }
@@ -51,21 +183,617 @@ esp_tim_start(os_timer_func_t *cb, void *payload)
 void ICACHE_FLASH_ATTR
 esp_tim_disarm(esp_tim_timer *timer)
 {
-  os_timer_disarm(timer->_os_timer);
+  os_timer_disarm(&timer->_os_timer);
 }
 
 void ICACHE_FLASH_ATTR
 esp_tim_stop(esp_tim_timer *timer)
 {
-  os_timer_disarm(timer->_os_timer);
-  os_free(timer->_os_timer);
-  os_free(timer);
+  esp_tim_disarm(timer);
+#ifdef ESP_TIM_STATS_ON
+  if (timer->_in_cb) {
+    // Released by stats_timer_cb when the callback returns.
+    timer->_free = timer->_allocated;
+    return;
+  }
+#endif
+  if (timer->_allocated) os_free(timer);
 }
 
 void ICACHE_FLASH_ATTR
 esp_tim_continue(esp_tim_timer *timer)
 {
-  os_timer_disarm(timer->_os_timer);
-  os_timer_setfn(timer->_os_timer, timer->os_timer_cb, (void *) timer);
-  os_timer_arm(timer->_os_timer, timer->delay, false);
+  esp_tim_arm(timer);
 }
+
+static void ICACHE_FLASH_ATTR
+sdk_timer_cb(void *arg)
+{
+  esp_tim_mux_run(arg);
+}
+
+static void ICACHE_FLASH_ATTR
+sdk_arm(esp_tim_mux *mux, uint32_t delay_us)
+{
+  os_timer_disarm(&mux->_os_timer);
+  os_timer_setfn(&mux->_os_timer, sdk_timer_cb, mux);
+  os_timer_arm(&mux->_os_timer, (delay_us + 999) / 1000, false);
+}
+
+static void ICACHE_FLASH_ATTR
+sdk_disarm(esp_tim_mux *mux)
+{
+  os_timer_disarm(&mux->_os_timer);
+}
+
+static uint32_t ICACHE_FLASH_ATTR
+sdk_now()
+{
+  return system_get_time();
+}
+
+// SDK timer backend (millisecond resolution).
+static const esp_tim_mux_backend sdk_backend = {
+  .arm = sdk_arm,
+  .disarm = sdk_disarm,
+  .now = sdk_now,
+};
+
+#ifdef USE_US_TIMER
+
+static void ICACHE_FLASH_ATTR
+us_arm_backend(esp_tim_mux *mux, uint32_t delay_us)
+{
+  if (delay_us < ESP_TIM_US_MIN) delay_us = ESP_TIM_US_MIN;
+  if (delay_us > ESP_TIM_US_MAX) delay_us = ESP_TIM_US_MAX;
+
+  os_timer_disarm(&mux->_os_timer);
+  os_timer_setfn(&mux->_os_timer, sdk_timer_cb, mux);
+  os_timer_arm_us(&mux->_os_timer, delay_us, false);
+}
+
+// SDK timer backend in microsecond mode.
+static const esp_tim_mux_backend us_backend = {
+  .arm = us_arm_backend,
+  .disarm = sdk_disarm,
+  .now = sdk_now,
+};
+
+#else
+
+// No ICACHE_FLASH_ATTR, must be in IRAM to run as interrupt handler.
+// Only posts the FRC1 task so timer callbacks never run in the
+// interrupt context.
+static void
+frc1_isr(void *arg)
+{
+  RTC_CLR_REG_MASK(FRC1_INT_ADDRESS, FRC1_INT_CLR_MASK);
+  system_os_post(ESP_TIM_US_TASK_PRIO, 0, 0);
+}
+
+/**
+ * FRC1 task running expired microsecond timers.
+ *
+ * @param e The task event.
+ */
+static void ICACHE_FLASH_ATTR
+frc1_task(os_event_t *e)
+{
+  esp_tim_mux_run(&us_mux);
+}
+
+static void ICACHE_FLASH_ATTR
+frc1_arm(esp_tim_mux *mux, uint32_t delay_us)
+{
+  if (delay_us < ESP_TIM_US_MIN) delay_us = ESP_TIM_US_MIN;
+  if (delay_us > ESP_TIM_US_MAX) delay_us = ESP_TIM_US_MAX;
+
+  RTC_REG_WRITE(FRC1_CTRL_ADDRESS, ESP_TIM_FRC1_ENABLE | ESP_TIM_FRC1_DIV16 | ESP_TIM_FRC1_EDGE_INT);
+  RTC_REG_WRITE(FRC1_LOAD_ADDRESS, delay_us * ESP_TIM_FRC1_TICKS_US);
+}
+
+static void ICACHE_FLASH_ATTR
+frc1_disarm(esp_tim_mux *mux)
+{
+  RTC_REG_WRITE(FRC1_CTRL_ADDRESS, 0);
+}
+
+// FRC1 hardware timer backend.
+static const esp_tim_mux_backend us_backend = {
+  .arm = frc1_arm,
+  .disarm = frc1_disarm,
+  .now = sdk_now,
+};
+
+#endif
+
+/**
+ * Get microsecond timers multiplexer.
+ *
+ * Initializes it on the first use.
+ *
+ * @return The multiplexer.
+ */
+static esp_tim_mux *ICACHE_FLASH_ATTR
+us_mux_get()
+{
+  if (us_mux_ready) return &us_mux;
+
+  esp_tim_mux_init(&us_mux, &us_backend);
+  esp_tim_us_info_reset();
+  us_mux_ready = true;
+
+#ifndef USE_US_TIMER
+  system_os_task(frc1_task, ESP_TIM_US_TASK_PRIO, us_task_queue, ESP_TIM_US_TASK_QUEUE_LEN);
+  ETS_FRC_TIMER1_INTR_ATTACH(frc1_isr, NULL);
+  TM1_EDGE_INT_ENABLE();
+  ETS_FRC1_INTR_ENABLE();
+#endif
+
+  return &us_mux;
+}
+
+/**
+ * Microsecond timer callback trampoline.
+ *
+ * Measures the callback lateness.
+ *
+ * @param arg The expired multiplexed timer.
+ */
+static void ICACHE_FLASH_ATTR
+us_timer_cb(void *arg)
+{
+  esp_tim_mux_timer *mux_timer = arg;
+  esp_tim_us_timer *timer = mux_timer->payload;
+  uint32_t late = system_get_time() - mux_timer->deadline_us;
+
+  us_info.fired++;
+  us_late_sum += late;
+  if (late < us_info.late_min_us) us_info.late_min_us = late;
+  if (late > us_info.late_max_us) us_info.late_max_us = late;
+
+#ifdef ESP_TIM_STATS_ON
+  timer->_in_cb = true;
+  stats_call(&mux_timer->stats, timer->os_timer_cb, timer, mux_timer->deadline_us);
+  timer->_in_cb = false;
+  if (timer->_free) os_free(timer);
+#else
+  timer->os_timer_cb(timer);
+#endif
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_init_us(esp_tim_us_timer *timer, os_timer_func_t *cb, void *payload, uint32_t delay_us)
+{
+  os_memset(timer, 0, sizeof(esp_tim_us_timer));
+  timer->os_timer_cb = cb;
+  timer->delay = delay_us;
+  timer->payload = payload;
+  esp_tim_mux_setfn(&timer->_mux_timer, us_timer_cb, (void *) timer);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_tim_arm_us(esp_tim_us_timer *timer)
+{
+  return esp_tim_mux_arm(us_mux_get(), &timer->_mux_timer, timer->delay);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_disarm_us(esp_tim_us_timer *timer)
+{
+  esp_tim_mux_disarm(&timer->_mux_timer);
+}
+
+esp_tim_us_timer *ICACHE_FLASH_ATTR
+esp_tim_start_delay_us(os_timer_func_t *cb, void *payload, uint32_t delay_us)
+{
+  esp_tim_us_timer *timer = os_malloc(sizeof(esp_tim_us_timer));
+  if (timer == NULL) return NULL;
+
+  esp_tim_init_us(timer, cb, payload, delay_us);
+  timer->_allocated = true;
+  if (!esp_tim_arm_us(timer)) {
+    os_free(timer);
+    return NULL;
+  }
+
+  return timer;
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_stop_us(esp_tim_us_timer *timer)
+{
+  esp_tim_disarm_us(timer);
+#ifdef ESP_TIM_STATS_ON
+  if (timer->_in_cb) {
+    // Released by us_timer_cb when the callback returns.
+    timer->_free = timer->_allocated;
+    return;
+  }
+#endif
+  if (timer->_allocated) os_free(timer);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_us_info_get(esp_tim_us_info *info)
+{
+  *info = us_info;
+  info->late_avg_us = us_info.fired > 0 ? us_late_sum / us_info.fired : 0;
+  if (us_info.fired == 0) info->late_min_us = 0;
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_us_info_reset()
+{
+  os_memset(&us_info, 0, sizeof(esp_tim_us_info));
+  us_info.min_delay_us = ESP_TIM_US_MIN;
+  us_info.late_min_us = 0xFFFFFFFF;
+  us_late_sum = 0;
+}
+
+/**
+ * Put timer at heap position.
+ *
+ * @param mux   The multiplexer.
+ * @param timer The timer.
+ * @param idx   The heap position.
+ */
+static void ICACHE_FLASH_ATTR
+heap_set(esp_tim_mux *mux, esp_tim_mux_timer *timer, uint16_t idx)
+{
+  mux->heap[idx] = timer;
+  timer->_idx = idx;
+}
+
+/**
+ * Move timer towards the heap root until heap order is restored.
+ *
+ * @param mux The multiplexer.
+ * @param idx The timer heap position.
+ */
+static void ICACHE_FLASH_ATTR
+heap_up(esp_tim_mux *mux, uint16_t idx)
+{
+  uint16_t parent;
+  esp_tim_mux_timer *timer = mux->heap[idx];
+
+  while (idx > 0) {
+    parent = (uint16_t) ((idx - 1) / 2);
+    if (!ESP_TIM_BEFORE(ESP_TIM_EXPIRY(timer), ESP_TIM_EXPIRY(mux->heap[parent]))) break;
+    heap_set(mux, mux->heap[parent], idx);
+    idx = parent;
+  }
+
+  heap_set(mux, timer, idx);
+}
+
+/**
+ * Move timer towards the heap leaves until heap order is restored.
+ *
+ * @param mux The multiplexer.
+ * @param idx The timer heap position.
+ */
+static void ICACHE_FLASH_ATTR
+heap_down(esp_tim_mux *mux, uint16_t idx)
+{
+  uint16_t child;
+  esp_tim_mux_timer *timer = mux->heap[idx];
+
+  while ((child = (uint16_t) (2 * idx + 1)) < mux->len) {
+    if (child + 1 < mux->len
+        && ESP_TIM_BEFORE(ESP_TIM_EXPIRY(mux->heap[child + 1]), ESP_TIM_EXPIRY(mux->heap[child]))) {
+      child++;
+    }
+    if (!ESP_TIM_BEFORE(ESP_TIM_EXPIRY(mux->heap[child]), ESP_TIM_EXPIRY(timer))) break;
+    heap_set(mux, mux->heap[child], idx);
+    idx = child;
+  }
+
+  heap_set(mux, timer, idx);
+}
+
+/**
+ * Remove timer from the heap.
+ *
+ * @param mux   The multiplexer.
+ * @param timer The timer.
+ */
+static void ICACHE_FLASH_ATTR
+heap_remove(esp_tim_mux *mux, esp_tim_mux_timer *timer)
+{
+  uint16_t idx = timer->_idx;
+  esp_tim_mux_timer *last = mux->heap[--mux->len];
+
+  timer->_idx = ESP_TIM_MUX_IDLE;
+  if (mux->len == 0) mux->_slack_max = 0;
+  if (last == timer) return;
+
+  heap_set(mux, last, idx);
+  heap_up(mux, idx);
+  heap_down(mux, last->_idx);
+}
+
+/**
+ * Arm the underlying timer for the earliest logical timer.
+ *
+ * @param mux The multiplexer.
+ */
+static void ICACHE_FLASH_ATTR
+mux_schedule(esp_tim_mux *mux)
+{
+  int32_t delay_us;
+
+  if (mux->_running) return;
+  if (mux->len == 0) {
+    mux->backend->disarm(mux);
+    return;
+  }
+
+  delay_us = (int32_t) (ESP_TIM_EXPIRY(mux->heap[0]) - mux->backend->now());
+  mux->backend->arm(mux, delay_us > 0 ? (uint32_t) delay_us : 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_mux_init(esp_tim_mux *mux, const esp_tim_mux_backend *backend)
+{
+  os_memset(mux, 0, sizeof(esp_tim_mux));
+  mux->backend = backend != NULL ? backend : &sdk_backend;
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_mux_setfn(esp_tim_mux_timer *timer, os_timer_func_t *cb, void *payload)
+{
+  os_memset(timer, 0, sizeof(esp_tim_mux_timer));
+  timer->cb = cb;
+  timer->payload = payload;
+  timer->_idx = ESP_TIM_MUX_IDLE;
+}
+
+/**
+ * Put timer with deadline already set on the heap or move it.
+ *
+ * @param mux   The multiplexer.
+ * @param timer The timer.
+ *
+ * @return true on success, false if multiplexer is full.
+ */
+static bool ICACHE_FLASH_ATTR
+mux_insert(esp_tim_mux *mux, esp_tim_mux_timer *timer)
+{
+  if (timer->_idx == ESP_TIM_MUX_IDLE) {
+    if (mux->len == ESP_TIM_MUX_SIZE) return false;
+    timer->_mux = mux;
+    if (timer->slack_us > mux->_slack_max) mux->_slack_max = timer->slack_us;
+    heap_set(mux, timer, mux->len++);
+    heap_up(mux, timer->_idx);
+  } else {
+    heap_up(mux, timer->_idx);
+    heap_down(mux, timer->_idx);
+  }
+
+  return true;
+}
+
+/**
+ * Arm logical timer.
+ *
+ * @param mux       The multiplexer.
+ * @param timer     The timer.
+ * @param delay_us  The delay in microseconds.
+ * @param period_us The period of periodic timer, 0 for one shot timer.
+ *
+ * @return true on success, false if multiplexer is full.
+ */
+static bool ICACHE_FLASH_ATTR
+mux_arm(esp_tim_mux *mux, esp_tim_mux_timer *timer, uint32_t delay_us, uint32_t period_us)
+{
+  uint32_t top;
+
+  // Armed on another multiplexer.
+  if (timer->_idx != ESP_TIM_MUX_IDLE && timer->_mux != mux) esp_tim_mux_disarm(timer);
+  if (delay_us > ESP_TIM_MUX_MAX_DELAY_US - timer->slack_us) {
+    delay_us = ESP_TIM_MUX_MAX_DELAY_US - timer->slack_us;
+  }
+
+  top = mux->len > 0 ? ESP_TIM_EXPIRY(mux->heap[0]) : 0;
+  timer->deadline_us = mux->backend->now() + delay_us;
+  timer->period_us = period_us;
+  timer->overruns = 0;
+  if (!mux_insert(mux, timer)) return false;
+
+  // Rearm underlying timer only when the earliest deadline changed.
+  if (mux->len == 1 || ESP_TIM_EXPIRY(mux->heap[0]) != top) mux_schedule(mux);
+
+  return true;
+}
+
+/**
+ * Compute the next deadline of periodic timer.
+ *
+ * @param timer The expired timer.
+ * @param now   The current time.
+ */
+static void ICACHE_FLASH_ATTR
+mux_next_period(esp_tim_mux_timer *timer, uint32_t now)
+{
+  uint32_t missed;
+
+  timer->deadline_us += timer->period_us;
+  if (ESP_TIM_BEFORE(now, timer->deadline_us)) return;
+
+  // Overrun, the next deadline already passed.
+  if (timer->policy == ESP_TIM_CATCH_UP) {
+    timer->overruns++;
+    return;
+  }
+
+  missed = (now - timer->deadline_us) / timer->period_us + 1;
+  timer->overruns += missed;
+  timer->deadline_us += missed * timer->period_us;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_arm(esp_tim_mux *mux, esp_tim_mux_timer *timer, uint32_t delay_us)
+{
+  return mux_arm(mux, timer, delay_us, 0);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_arm_periodic(esp_tim_mux *mux, esp_tim_mux_timer *timer,
+                         uint32_t period_us, esp_tim_policy policy)
+{
+  if (period_us == 0) return false;
+  if (period_us > ESP_TIM_MUX_MAX_DELAY_US) period_us = ESP_TIM_MUX_MAX_DELAY_US;
+
+  timer->policy = policy;
+
+  return mux_arm(mux, timer, period_us, period_us);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_mux_set_slack(esp_tim_mux_timer *timer, uint32_t slack_us)
+{
+  esp_tim_mux *mux = timer->_mux;
+  uint32_t top;
+
+  if (slack_us > ESP_TIM_MUX_MAX_DELAY_US / 2) slack_us = ESP_TIM_MUX_MAX_DELAY_US / 2;
+  if (timer->_idx == ESP_TIM_MUX_IDLE) {
+    timer->slack_us = slack_us;
+    return;
+  }
+
+  // Armed timer changes its heap key, move it.
+  top = ESP_TIM_EXPIRY(mux->heap[0]);
+  timer->slack_us = slack_us;
+  mux_insert(mux, timer);
+  if (slack_us > mux->_slack_max) mux->_slack_max = slack_us;
+  if (ESP_TIM_EXPIRY(mux->heap[0]) != top) mux_schedule(mux);
+}
+
+uint32_t ICACHE_FLASH_ATTR
+esp_tim_mux_saved(const esp_tim_mux *mux)
+{
+  return mux->saved;
+}
+
+uint32_t ICACHE_FLASH_ATTR
+esp_tim_mux_overruns(const esp_tim_mux_timer *timer)
+{
+  return timer->overruns;
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_mux_disarm(esp_tim_mux_timer *timer)
+{
+  esp_tim_mux *mux = timer->_mux;
+  bool top;
+
+  if (timer->_idx == ESP_TIM_MUX_IDLE) return;
+
+  top = timer->_idx == 0;
+  heap_remove(mux, timer);
+  if (top) mux_schedule(mux);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_armed(const esp_tim_mux_timer *timer)
+{
+  return timer->_idx != ESP_TIM_MUX_IDLE;
+}
+
+/**
+ * Find timer whose deadline passed in the heap subtree.
+ *
+ * The heap is ordered by deadline plus slack so without slack due
+ * timers are popped from the root. Subtrees whose expiry minus the
+ * largest slack is after now can't have due timers and are skipped.
+ *
+ * @param mux The multiplexer.
+ * @param idx The subtree root heap position.
+ * @param now The current time.
+ *
+ * @return The timer or NULL.
+ */
+static esp_tim_mux_timer *ICACHE_FLASH_ATTR
+mux_due(esp_tim_mux *mux, uint16_t idx, uint32_t now)
+{
+  esp_tim_mux_timer *timer;
+
+  if (idx >= mux->len) return NULL;
+
+  timer = mux->heap[idx];
+  if (!ESP_TIM_BEFORE(now, timer->deadline_us)) return timer;
+  if (ESP_TIM_BEFORE(now + mux->_slack_max, ESP_TIM_EXPIRY(timer))) return NULL;
+
+  timer = mux_due(mux, (uint16_t) (2 * idx + 1), now);
+  if (timer != NULL) return timer;
+
+  return mux_due(mux, (uint16_t) (2 * idx + 2), now);
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_mux_run(esp_tim_mux *mux)
+{
+  esp_tim_mux_timer *timer;
+  uint32_t deadline_us;
+  uint32_t now = mux->backend->now();
+  // Timers rearmed with zero delay wait for the next run.
+  uint16_t budget = mux->len;
+
+  mux->_running = true;
+  while (budget-- > 0 && (timer = mux_due(mux, 0, now)) != NULL) {
+    // Runs in wakeup of another timer.
+    if (ESP_TIM_BEFORE(now, ESP_TIM_EXPIRY(timer))) mux->saved++;
+    deadline_us = timer->deadline_us;
+
+    if (timer->period_us > 0) {
+      // Rearm before callback so it can disarm or rearm the timer.
+      mux_next_period(timer, now);
+      heap_down(mux, timer->_idx);
+    } else {
+      heap_remove(mux, timer);
+    }
+    ESP_TIM_MUX_CALL(timer, deadline_us);
+  }
+  mux->_running = false;
+
+  mux_schedule(mux);
+}
+
+#ifdef ESP_TIM_STATS_ON
+
+void ICACHE_FLASH_ATTR
+esp_tim_stats_reset(esp_tim_stats *stats)
+{
+  os_memset(stats, 0, sizeof(esp_tim_stats));
+}
+
+/**
+ * Print histogram.
+ *
+ * @param label The histogram label.
+ * @param hist  The histogram.
+ * @param calls The number of measurements.
+ */
+static void ICACHE_FLASH_ATTR
+stats_print_hist(const char *label, const esp_tim_hist *hist, uint32_t calls)
+{
+  uint8_t bucket;
+
+  os_printf("    %s (us) min %d avg %d max %d\n", label, hist->min,
+            calls > 0 ? hist->sum / calls : 0, hist->max);
+  for (bucket = 0; bucket < ESP_TIM_STATS_BUCKETS; bucket++) {
+    if (hist->hist[bucket] == 0) continue;
+    os_printf("        <%d %d\n", 2 << bucket, hist->hist[bucket]);
+  }
+}
+
+void ICACHE_FLASH_ATTR
+esp_tim_stats_print(const char *name, const esp_tim_stats *stats)
+{
+  os_printf("timer %s calls %d\n", name, stats->calls);
+  stats_print_hist("late", &stats->late, stats->calls);
+  stats_print_hist("run", &stats->run, stats->calls);
+}
+
+#endif
@@ -25,14 +25,174 @@
 // The default timer delay in milliseconds.
 #define ESP_TIM_DELAY_DEF 10
 
+// Define ESP_TIM_STATS_ON to measure timer callbacks lateness and duration.
+// It changes the size of timer structures so it must be defined for every
+// file including this header, not only when building the library.
+
+// The number of statistics histogram buckets.
+// Bucket N counts values below 2^(N+1) microseconds,
+// the last one counts everything above.
+#define ESP_TIM_STATS_BUCKETS 16
+
+#ifdef ESP_TIM_STATS_ON
+
+// Summary of measurements in microseconds.
+typedef struct {
+  uint32_t min;                         // The minimum.
+  uint32_t max;                         // The maximum.
+  uint32_t sum;                         // The sum, average is sum / calls.
+  uint16_t hist[ESP_TIM_STATS_BUCKETS]; // The log2 histogram.
+} esp_tim_hist;
+
+// Timer callback statistics.
+typedef struct {
+  uint32_t calls;    // The number of callback calls.
+  esp_tim_hist late; // The time between deadline and callback call.
+  esp_tim_hist run;  // The callback duration.
+} esp_tim_stats;
+
+#endif
+
+// The maximum number of logical timers armed at the same time on one
+// multiplexer. Every slot costs 4 bytes of RAM.
+#ifndef ESP_TIM_MUX_SIZE
+  #define ESP_TIM_MUX_SIZE 64
+#endif
+
+// The longest delay of multiplexed timer (deadlines are 32 bit
+// microsecond timestamps compared with wrap around).
+#define ESP_TIM_MUX_MAX_DELAY_US 0x7FFFFFFF
+
+typedef struct esp_tim_mux esp_tim_mux;
+
+// What periodic timer does when it's late by whole periods.
+typedef enum {
+  ESP_TIM_CATCH_UP, // Call callback for every missed period as soon as possible.
+  ESP_TIM_SKIP      // Skip missed periods and stay on the original grid.
+} esp_tim_policy;
+
+// Logical timer multiplexed on one hardware or SDK timer.
+typedef struct {
+  os_timer_func_t *cb;  // The callback, gets pointer to the timer.
+  void *payload;        // The payload.
+  uint32_t deadline_us; // The expiry time (system_get_time based).
+  uint32_t slack_us;    // How much later the callback may run to share wakeup.
+  uint32_t period_us;   // The period of periodic timer, 0 for one shot timer.
+  uint32_t overruns;    // The number of periods missed by periodic timer.
+  esp_tim_policy policy; // Periodic timer overrun policy.
+#ifdef ESP_TIM_STATS_ON
+  esp_tim_stats stats;  // Callback statistics.
+#endif
+  esp_tim_mux *_mux;    // The multiplexer the timer is armed on. Don't touch it.
+  uint16_t _idx;        // The position in the multiplexer heap. Don't touch it.
+} esp_tim_mux_timer;
+
+// Multiplexer backend driving the single underlying timer.
+typedef struct {
+  // Arm underlying timer to call esp_tim_mux_run after delay_us.
+  void (*arm)(esp_tim_mux *mux, uint32_t delay_us);
+  // Disarm underlying timer.
+  void (*disarm)(esp_tim_mux *mux);
+  // The current time in microseconds.
+  uint32_t (*now)(void);
+} esp_tim_mux_backend;
+
+// Timer multiplexer. Keeps logical timers in binary min-heap ordered
+// by deadline plus slack and arms the underlying timer for the earliest one.
+struct esp_tim_mux {
+  esp_tim_mux_timer *heap[ESP_TIM_MUX_SIZE]; // The armed timers.
+  uint16_t len;                              // The number of armed timers.
+  uint32_t saved;                            // The number of wakeups saved by slack.
+  uint32_t _slack_max;                       // Upper bound of armed timers slack. Don't touch it.
+  const esp_tim_mux_backend *backend;        // The underlying timer.
+  os_timer_t _os_timer;                      // SDK backend timer. Don't touch it.
+  bool _running;                             // Running expired timers. Don't touch it.
+};
+
 // The structure wrapping timer data.
 typedef struct {
-  os_timer_func_t *os_timer_cb; // System timer callback.
-  os_timer_t *_os_timer;        // System timer. Don't touch it.
-  uint32_t delay;               // The timer delay in milliseconds.
-  void *payload;                // The payload.
+  os_timer_func_t *os_timer_cb;  // System timer callback.
+  os_timer_t _os_timer;          // System timer. Don't touch it.
+  uint32_t delay;                // The timer delay in milliseconds.
+  void *payload;                 // The payload.
+  bool _allocated;               // Allocated by esp_tim_start*. Don't touch it.
+#ifdef ESP_TIM_STATS_ON
+  esp_tim_stats stats;           // Callback statistics.
+  uint32_t _deadline_us;         // The expiry time. Don't touch it.
+  bool _in_cb;                   // Callback is running. Don't touch it.
+  bool _free;                    // Stopped by its callback. Don't touch it.
+#endif
 } esp_tim_timer;
 
+// The shortest delay of microsecond timers, shorter delays are rounded up.
+#ifdef USE_US_TIMER
+  // SDK timer in microsecond mode (system_timer_reinit).
+  #define ESP_TIM_US_MIN 100
+#else
+  // FRC1 hardware timer.
+  #define ESP_TIM_US_MIN 50
+#endif
+
+// The SDK task priority of the task running FRC1 microsecond timers
+// (USE_US_TIMER not defined). The SDK allows one task per priority
+// so it must differ from other tasks (ESP_EB_TASK_PRIO).
+#ifndef ESP_TIM_US_TASK_PRIO
+  #define ESP_TIM_US_TASK_PRIO 2 // USER_TASK_PRIO_2
+#endif
+
+// Microsecond timer. Millisecond timers don't carry the multiplexer
+// record, they are separate types.
+typedef struct {
+  os_timer_func_t *os_timer_cb;  // The callback, gets pointer to the timer.
+  uint32_t delay;                // The timer delay in microseconds.
+  void *payload;                 // The payload.
+  bool _allocated;               // Allocated by esp_tim_start_delay_us. Don't touch it.
+  esp_tim_mux_timer _mux_timer;  // Multiplexed timer. Don't touch it.
+#ifdef ESP_TIM_STATS_ON
+  bool _in_cb;                   // Callback is running. Don't touch it.
+  bool _free;                    // Stopped by its callback. Don't touch it.
+#endif
+} esp_tim_us_timer;
+
+#ifdef ESP_TIM_STATS_ON
+  // Microsecond timer callback statistics.
+  #define ESP_TIM_US_STATS(timer) (&(timer)->_mux_timer.stats)
+#endif
+
+// Microsecond timers shortest delay and measured callback lateness.
+typedef struct {
+  uint32_t min_delay_us;  // The shortest delay (ESP_TIM_US_MIN, not measured).
+  uint32_t fired;         // The number of callbacks measured.
+  uint32_t late_min_us;   // The minimum callback lateness.
+  uint32_t late_avg_us;   // The average callback lateness.
+  uint32_t late_max_us;   // The maximum callback lateness.
+} esp_tim_us_info;
+
+
+/**
+ * Initialize timer in caller provided storage.
+ *
+ * Never allocates memory. The storage (static, pooled or part of
+ * another structure) must stay valid until the timer is disarmed.
+ * The callback gets pointer to the timer structure.
+ *
+ * @param timer   The timer to initialize.
+ * @param cb      The callback.
+ * @param payload The timer payload.
+ * @param delay   The delay in milliseconds.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_init(esp_tim_timer *timer, os_timer_func_t *cb, void *payload, uint32_t delay);
+
+/**
+ * Arm timer initialized with esp_tim_init.
+ *
+ * Rearming armed timer restarts the delay.
+ *
+ * @param timer The timer.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_arm(esp_tim_timer *timer);
 
 /**
  * Start timer.
@@ -65,9 +225,94 @@ esp_tim_disarm(esp_tim_timer *timer);
 esp_tim_timer *ICACHE_FLASH_ATTR
 esp_tim_start_delay(os_timer_func_t *cb, void *payload, uint32_t delay);
 
+/**
+ * Initialize microsecond timer in caller provided storage.
+ *
+ * Same as esp_tim_init but the delay is in microseconds.
+ * See esp_tim_start_delay_us.
+ *
+ * @param timer    The timer to initialize.
+ * @param cb       The callback.
+ * @param payload  The timer payload.
+ * @param delay_us The delay in microseconds.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_init_us(esp_tim_us_timer *timer, os_timer_func_t *cb, void *payload, uint32_t delay_us);
+
+/**
+ * Arm microsecond timer initialized with esp_tim_init_us.
+ *
+ * Rearming armed timer restarts the delay. Call it from
+ * the callback to run the timer again.
+ *
+ * @param timer The timer.
+ *
+ * @return true on success, false if ESP_TIM_MUX_SIZE timers are armed.
+ */
+bool ICACHE_FLASH_ATTR
+esp_tim_arm_us(esp_tim_us_timer *timer);
+
+/**
+ * Disarm microsecond timer.
+ *
+ * @param timer The timer.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_disarm_us(esp_tim_us_timer *timer);
+
+/**
+ * Stop microsecond timer.
+ *
+ * Releases memory of timers started with esp_tim_start_delay_us,
+ * timers initialized with esp_tim_init_us are only disarmed.
+ *
+ * @param timer The timer.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_stop_us(esp_tim_us_timer *timer);
+
+/**
+ * Start timer with delay in microseconds.
+ *
+ * Microsecond timers are multiplexed on the SDK timer in microsecond
+ * mode when USE_US_TIMER is defined (system_timer_reinit must be called
+ * at the beginning of user_init) or on FRC1 hardware timer otherwise.
+ * FRC1 interrupt only posts SDK task (ESP_TIM_US_TASK_PRIO) which runs
+ * the callbacks, the task switch adds to their lateness. FRC1 can't be
+ * used by PWM at the same time. At most ESP_TIM_MUX_SIZE microsecond
+ * timers can be armed at once.
+ *
+ * @param cb       The callback.
+ * @param payload  The timer payload.
+ * @param delay_us The delay in microseconds (rounded up to ESP_TIM_US_MIN).
+ *
+ * @return Returns timer structure or NULL when out of memory or timers.
+ */
+esp_tim_us_timer *ICACHE_FLASH_ATTR
+esp_tim_start_delay_us(os_timer_func_t *cb, void *payload, uint32_t delay_us);
+
+/**
+ * Get microsecond timers shortest delay and measured callback lateness.
+ *
+ * The lateness is the time between timer deadline and its callback.
+ *
+ * @param info The structure to fill.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_us_info_get(esp_tim_us_info *info);
+
+/**
+ * Reset microsecond timers jitter measurements.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_us_info_reset();
+
 /**
  * Stop timer.
  *
+ * Releases memory of timers started with esp_tim_start*,
+ * timers initialized with esp_tim_init are only disarmed.
+ *
  * @param timer
  */
 void ICACHE_FLASH_ATTR
@@ -81,4 +326,148 @@ esp_tim_stop(esp_tim_timer *timer);
 void ICACHE_FLASH_ATTR
 esp_tim_continue(esp_tim_timer *timer);
 
+/**
+ * Initialize timer multiplexer.
+ *
+ * @param mux     The multiplexer.
+ * @param backend The underlying timer or NULL for SDK timer
+ *                (millisecond resolution).
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_mux_init(esp_tim_mux *mux, const esp_tim_mux_backend *backend);
+
+/**
+ * Initialize logical timer.
+ *
+ * @param timer   The timer.
+ * @param cb      The callback.
+ * @param payload The timer payload.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_mux_setfn(esp_tim_mux_timer *timer, os_timer_func_t *cb, void *payload);
+
+/**
+ * Arm logical timer.
+ *
+ * Rearming armed timer moves its deadline. Takes O(log n).
+ *
+ * @param mux      The multiplexer.
+ * @param timer    The timer initialized with esp_tim_mux_setfn.
+ * @param delay_us The delay in microseconds (up to ESP_TIM_MUX_MAX_DELAY_US).
+ *
+ * @return true on success, false if multiplexer is full.
+ */
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_arm(esp_tim_mux *mux, esp_tim_mux_timer *timer, uint32_t delay_us);
+
+/**
+ * Arm periodic logical timer.
+ *
+ * Deadlines are absolute: deadline N is N periods after arming no matter
+ * how late callbacks run so the timer doesn't drift. When the timer is
+ * late by whole periods (overrun) the missed periods are counted and
+ * handled according to the policy.
+ *
+ * @param mux       The multiplexer.
+ * @param timer     The timer initialized with esp_tim_mux_setfn.
+ * @param period_us The period in microseconds (up to ESP_TIM_MUX_MAX_DELAY_US).
+ * @param policy    The overrun policy.
+ *
+ * @return true on success, false if multiplexer is full.
+ */
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_arm_periodic(esp_tim_mux *mux, esp_tim_mux_timer *timer,
+                         uint32_t period_us, esp_tim_policy policy);
+
+/**
+ * Set logical timer slack.
+ *
+ * The callback may run up to slack_us after the deadline. The multiplexer
+ * wakes up at the latest time of the earliest timer and runs every timer
+ * whose deadline passed so timers with close deadlines share one wakeup.
+ * Takes effect right away, armed timer is moved in the multiplexer heap.
+ *
+ * @param timer    The timer initialized with esp_tim_mux_setfn.
+ * @param slack_us The slack in microseconds (up to ESP_TIM_MUX_MAX_DELAY_US / 2).
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_mux_set_slack(esp_tim_mux_timer *timer, uint32_t slack_us);
+
+/**
+ * Get the number of wakeups saved by timer slack.
+ *
+ * Counts callbacks run before their deadline plus slack, in the wakeup
+ * of another timer.
+ *
+ * @param mux The multiplexer.
+ *
+ * @return The number of saved wakeups.
+ */
+uint32_t ICACHE_FLASH_ATTR
+esp_tim_mux_saved(const esp_tim_mux *mux);
+
+/**
+ * Get the number of periods missed by periodic timer.
+ *
+ * @param timer The timer.
+ *
+ * @return The number of missed periods since arming.
+ */
+uint32_t ICACHE_FLASH_ATTR
+esp_tim_mux_overruns(const esp_tim_mux_timer *timer);
+
+/**
+ * Disarm logical timer.
+ *
+ * Takes O(log n). Disarming not armed timer does nothing.
+ *
+ * @param timer The timer.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_mux_disarm(esp_tim_mux_timer *timer);
+
+/**
+ * Check if logical timer is armed.
+ *
+ * @param timer The timer.
+ *
+ * @return true if armed.
+ */
+bool ICACHE_FLASH_ATTR
+esp_tim_mux_armed(const esp_tim_mux_timer *timer);
+
+/**
+ * Call callbacks of expired timers and rearm the underlying timer.
+ *
+ * Called by backends when the underlying timer fires.
+ *
+ * @param mux The multiplexer.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_mux_run(esp_tim_mux *mux);
+
+#ifdef ESP_TIM_STATS_ON
+
+/**
+ * Reset timer statistics.
+ *
+ * @param stats The statistics (esp_tim_timer or esp_tim_mux_timer stats
+ *              field, ESP_TIM_US_STATS of microsecond timer).
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_stats_reset(esp_tim_stats *stats);
+
+/**
+ * Print timer statistics.
+ *
+ * For debugging purposes.
+ *
+ * @param name  The timer name.
+ * @param stats The statistics.
+ */
+void ICACHE_FLASH_ATTR
+esp_tim_stats_print(const char *name, const esp_tim_stats *stats);
+
+#endif
+
 #endif //ESP_TIM_H